@@ -0,0 +1,157 @@
+/*
+ * Keypress-to-render latency benchmark. Runs a small TUI built on
+ * LD::TUI::getch and LD::ANSI in a pseudo-terminal, types a keystroke
+ * script into it and prints p50/p99/p999 latency and throughput.
+ *
+ *     latency [keys per second] [keystrokes] [script file]
+ *
+ * A rate of 0 (the default) sends each key as soon as the last one was
+ * drawn. Without a script file, it types a mix of arrows, PgUp/PgDn and
+ * letters. Build it with the CMake `latency` target, or by hand:
+ *
+ *     g++ -std=c++17 -O2 -I.. latency.cpp -o latency -lutil
+ */
+
+#include <clocale>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../ld_ansi.hpp"
+#include "../ld_output.hpp"
+#include "../ld_pty.hpp"
+#include "../ld_tui.hpp"
+
+namespace {
+	constexpr size_t ROWS = 20;
+
+	/**
+	 * Every frame ends with this, so the harness knows it's done.
+	 */
+	const std::string FRAME_END = "\033[?25h";
+
+	/**
+	 * A list with a moving selection that redraws every row on every key,
+	 * like a typical menu.
+	 */
+	void tui() {
+		using LD::TUI::Keys;
+
+		std::setlocale(LC_ALL, "C.UTF-8");
+
+		LD::TUI::RawMode raw;
+
+		size_t selected = 0;
+		size_t typed    = 0;
+
+		while (true) {
+			std::wstring frame = LD::ANSI::c_off() + LD::ANSI::c_home();
+
+			for (size_t row = 0; row < ROWS; row++) {
+				frame.append(row == selected ? L"> " : L"  ");
+				frame.append(L"item " + LD::wtostring(row));
+				frame.append(LD::ANSI::erase_line(LD::ANSI::ELINEFROMC));
+				frame.append(L"\r\n");
+			}
+
+			frame.append(L"typed " + LD::wtostring(typed));
+			frame.append(LD::ANSI::erase_line(LD::ANSI::ELINEFROMC));
+			frame.append(LD::ANSI::c_on());
+
+			LD::ofl(frame);
+
+			Keys::Key key = LD::TUI::getch();
+
+			switch (Keys::base(key)) {
+				case Keys::NUL:
+				case Keys::q:
+					return;
+				case Keys::UP:
+					selected = (selected + ROWS - 1) % ROWS;
+
+					break;
+				case Keys::DOWN:
+					selected = (selected + 1) % ROWS;
+
+					break;
+				case Keys::PAGE_UP:
+					selected = 0;
+
+					break;
+				case Keys::PAGE_DOWN:
+					selected = ROWS - 1;
+
+					break;
+				default:
+					typed++;
+			}
+		}
+	}
+
+	std::vector<std::string> default_script(size_t count) {
+		static const char * const KEYS[] = {
+			"\033[A", "\033[B", "\033[B", "x", "\033[5~", "\033[6~", "y"
+		};
+
+		std::vector<std::string> script;
+
+		for (size_t i = 0; i < count; i++) {
+			script.emplace_back(KEYS[i % std::size(KEYS)]);
+		}
+
+		return script;
+	}
+}
+
+int main(int argc, char ** argv) {
+	double rate  = argc > 1 ? std::atof(argv[1]) : 0;
+	size_t count = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 10000;
+
+	std::vector<std::string> script;
+
+	try {
+		if (argc > 3) {
+			std::ifstream     file(argv[3]);
+			std::stringstream text;
+
+			if (!file) {
+				throw std::runtime_error(std::string("can't open ") + argv[3]);
+			}
+
+			text << file.rdbuf();
+			script = LD::PTY::parse_script(text.str());
+
+			// loop the script to fill up the requested count
+			size_t recorded = script.size();
+
+			for (size_t i = recorded; i < count && recorded > 0; i++) {
+				script.push_back(script[i % recorded]);
+			}
+		} else {
+			script = default_script(count);
+		}
+	} catch (const std::exception & e) {
+		std::fprintf(stderr, "%s\n", e.what());
+
+		return 1;
+	}
+
+	LD::PTY::LatencyHarness harness(tui);
+	LD::PTY::LatencyReport  report = harness.run(script, rate, FRAME_END);
+
+	std::printf("keys       %zu sent, %zu answered\n", report.keys,
+	            report.responses);
+	std::printf("latency    p50 %.1f us, p99 %.1f us, p999 %.1f us, "
+	            "max %.1f us\n", report.p50, report.p99, report.p999,
+	            report.max);
+	std::printf("throughput %.0f keys/s, %.0f bytes/s (%zu bytes)\n",
+	            report.keys_per_second, report.bytes_per_second,
+	            report.bytes_out);
+
+	return report.responses == report.keys ? 0 : 1;
+}
@@ -0,0 +1,217 @@
+/*
+ * Sampling benchmark. Times each part of ld_sample.hpp against the naive
+ * way of doing the same thing:
+ *
+ *  - weighted choice: AliasTable against a linear scan over the weights
+ *  - shuffling: LD::shuffle against Fisher-Yates with `%`
+ *  - sampling a stream: LD::reservoir_sample against copying the stream
+ *    into a vector and shuffling the front of it
+ *
+ *     sampling [weights / elements] [draws / rounds]
+ *
+ * Build it with the CMake `sampling` target, or by hand:
+ *
+ *     g++ -std=c++17 -O2 -I.. sampling.cpp -o sampling
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iterator>
+#include <numeric>
+#include <utility>
+#include <vector>
+
+#include "../ld_prng.hpp"
+#include "../ld_sample.hpp"
+
+namespace {
+	using clock = std::chrono::steady_clock;
+
+	/**
+	 * Counts from 0 to a limit, one element at a time, like reading a
+	 * stream that can't be rewound.
+	 */
+	class Stream {
+		public:
+			using iterator_category = std::input_iterator_tag;
+			using value_type        = uint64_t;
+			using difference_type   = std::ptrdiff_t;
+			using pointer           = const uint64_t *;
+			using reference         = const uint64_t &;
+
+			explicit Stream(uint64_t at = 0) : at(at) {}
+
+			const uint64_t & operator*() const {
+				return at;
+			}
+
+			Stream & operator++() {
+				at++;
+
+				return * this;
+			}
+
+			Stream operator++(int) {
+				Stream old = * this;
+
+				at++;
+
+				return old;
+			}
+
+			bool operator==(const Stream & other) const {
+				return at == other.at;
+			}
+
+			bool operator!=(const Stream & other) const {
+				return at != other.at;
+			}
+
+		private:
+			uint64_t at;
+	};
+
+	/**
+	 * Keeps results alive, so the compiler can't drop the work.
+	 */
+	uint64_t sink = 0;
+
+	template <class Fn>
+		double time_ms(Fn && fn) {
+			auto start = clock::now();
+
+			fn();
+
+			return std::chrono::duration<double, std::milli>(
+				clock::now() - start
+			).count();
+		}
+
+	void report(const char * name, double naive, double fast) {
+		std::printf("%-10s naive %9.2f ms, ld %9.2f ms, %6.1fx\n", name,
+		            naive, fast, fast > 0 ? naive / fast : 0);
+	}
+
+	size_t naive_choice(const std::vector<double> & weights, double total,
+	                    LD::Xoshiro256 & rng) {
+		double target = LD::next_open_unit(rng) * total;
+
+		for (size_t i = 0; i < weights.size(); i++) {
+			target -= weights[i];
+
+			if (target < 0) {
+				return i;
+			}
+		}
+
+		return weights.size() - 1;
+	}
+
+	template <class RandomIt>
+		void naive_shuffle(RandomIt first, RandomIt last,
+		                   LD::Xoshiro256 & rng) {
+			using std::swap;
+
+			for (auto i = last - first - 1; i > 0; i--) {
+				swap(first[i], first[rng() % static_cast<uint64_t>(i + 1)]);
+			}
+		}
+
+	std::vector<uint64_t> naive_sample(Stream first, Stream last, size_t k,
+	                                   LD::Xoshiro256 & rng) {
+		std::vector<uint64_t> all(first, last);
+
+		if (k > all.size()) {
+			k = all.size();
+		}
+
+		for (size_t i = 0; i < k; i++) {
+			uint64_t j = i + rng() % (all.size() - i);
+
+			std::swap(all[i], all[j]);
+		}
+
+		all.resize(k);
+
+		return all;
+	}
+}
+
+int main(int argc, char ** argv) {
+	size_t n     = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000;
+	size_t draws = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 1000000;
+
+	if (n == 0) {
+		std::fprintf(stderr, "need at least one weight\n");
+
+		return 1;
+	}
+
+	LD::Xoshiro256 rng(42);
+
+	std::vector<double> weights(n);
+
+	for (size_t i = 0; i < n; i++) {
+		weights[i] = 1 + static_cast<double>(i % 17);
+	}
+
+	double total = std::accumulate(weights.begin(), weights.end(), 0.0);
+
+	// weighted choice, including building the table
+	double naive = time_ms([&] {
+		for (size_t i = 0; i < draws; i++) {
+			sink += naive_choice(weights, total, rng);
+		}
+	});
+
+	double fast = time_ms([&] {
+		LD::AliasTable table(weights);
+
+		for (size_t i = 0; i < draws; i++) {
+			sink += table(rng);
+		}
+	});
+
+	report("choice", naive, fast);
+
+	// shuffling the whole thing, draws / n times
+	std::vector<uint64_t> deck(n);
+	std::iota(deck.begin(), deck.end(), 0);
+
+	size_t rounds = draws / n > 0 ? draws / n : 1;
+
+	naive = time_ms([&] {
+		for (size_t i = 0; i < rounds; i++) {
+			naive_shuffle(deck.begin(), deck.end(), rng);
+			sink += deck[0];
+		}
+	});
+
+	fast = time_ms([&] {
+		for (size_t i = 0; i < rounds; i++) {
+			LD::shuffle(deck.begin(), deck.end(), rng);
+			sink += deck[0];
+		}
+	});
+
+	report("shuffle", naive, fast);
+
+	// n out of a stream of draws elements
+	naive = time_ms([&] {
+		auto picked = naive_sample(Stream(0), Stream(draws), n, rng);
+		sink += picked[0];
+	});
+
+	fast = time_ms([&] {
+		auto picked = LD::reservoir_sample(Stream(0), Stream(draws), n, rng);
+		sink += picked[0];
+	});
+
+	report("reservoir", naive, fast);
+
+	// so the work above can't be optimized out
+	std::printf("checksum   %llu\n", static_cast<unsigned long long>(sink));
+
+	return 0;
+}
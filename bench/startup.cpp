@@ -0,0 +1,145 @@
+/*
+ * Startup benchmark. Runs itself, a bare `int main() {}` binary and one
+ * that only loads the C++ runtime over and over, and prints how long each
+ * takes to start and exit. They all return as soon as they reach main(),
+ * so the differences are what the C++ runtime and then the library cost
+ * before main(): static initializers, relocations and shared libraries.
+ *
+ *     startup [runs]
+ *
+ * The baselines are `startup_bare` and `startup_cxx`, next to this binary.
+ * Build all three with the CMake `startup` target, or by hand:
+ *
+ *     g++ -std=c++17 -O2 startup_bare.cpp -o startup_bare
+ *     g++ -std=c++17 -O2 -DLD_STARTUP_CXX startup_bare.cpp -o startup_cxx
+ *     g++ -std=c++17 -O2 -I.. startup.cpp -o startup -lutil
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <spawn.h>
+#include <sys/wait.h>
+
+#include "../main.hpp"
+
+extern char ** environ;
+
+namespace {
+	using clock = std::chrono::steady_clock;
+
+	const char * CHILD = "--child";
+
+	/**
+	 * Runs `path` a number of times and returns how long each run took, in
+	 * microseconds, sorted.
+	 *
+	 * @param path The program to run
+	 * @param arg An argument to pass it, or nullptr
+	 * @param runs How many times to run it
+	 * @return Each run's duration, fastest first
+	 */
+	std::vector<double> time_runs(const std::string & path, const char * arg,
+	                              size_t runs) {
+		std::vector<double> times;
+		times.reserve(runs);
+
+		char * argv[] = {
+			const_cast<char *>(path.c_str()),
+			const_cast<char *>(arg),
+			nullptr
+		};
+
+		for (size_t i = 0; i < runs; i++) {
+			auto  start = clock::now();
+			pid_t pid;
+
+			if (posix_spawn(&pid, path.c_str(), nullptr, nullptr, argv, environ) != 0) {
+				throw std::runtime_error("can't run " + path);
+			}
+
+			int status;
+
+			if (waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+				throw std::runtime_error(path + " didn't exit cleanly");
+			}
+
+			times.push_back(std::chrono::duration<double, std::micro>(
+				clock::now() - start
+			).count());
+		}
+
+		std::sort(times.begin(), times.end());
+
+		return times;
+	}
+
+	double mean(const std::vector<double> & times) {
+		double total = 0;
+
+		for (double time : times) {
+			total += time;
+		}
+
+		return times.empty() ? 0 : total / times.size();
+	}
+
+	double percentile(const std::vector<double> & times, double p) {
+		return times.empty() ? 0 : times[static_cast<size_t>(p * (times.size() - 1))];
+	}
+
+	void report(const char * name, const std::vector<double> & times) {
+		std::printf("%-6s mean %8.1f us, p50 %8.1f us, p99 %8.1f us\n", name,
+		            mean(times), percentile(times, 0.5), percentile(times, 0.99));
+	}
+}
+
+int main(int argc, char ** argv) {
+	if (argc > 1 && std::strcmp(argv[1], CHILD) == 0) {
+		// keep the library's out-of-line code linked in, doing next to nothing
+		return LD::s2wstr("").empty() ? 0 : 1;
+	}
+
+	size_t runs = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000;
+
+	std::string self  = argv[0];
+	size_t      slash = self.rfind('/');
+	std::string dir   = slash == std::string::npos ? "./" : self.substr(0, slash + 1);
+	std::string bare  = dir + "startup_bare";
+	std::string cxx   = dir + "startup_cxx";
+
+	if (runs == 0) {
+		std::fprintf(stderr, "need at least one run\n");
+
+		return 1;
+	}
+
+	try {
+		// warm the page cache, so the first runs aren't counted cold
+		time_runs(bare, nullptr, 10);
+		time_runs(cxx, nullptr, 10);
+		time_runs(self, CHILD, 10);
+
+		std::vector<double> base    = time_runs(bare, nullptr, runs);
+		std::vector<double> runtime = time_runs(cxx, nullptr, runs);
+		std::vector<double> ld      = time_runs(self, CHILD, runs);
+
+		report("bare", base);
+		report("c++", runtime);
+		report("ld", ld);
+
+		std::printf("c++ runtime  %+8.1f us at p50\n", percentile(runtime, 0.5) - percentile(base, 0.5));
+		std::printf("library      %+8.1f us at p50\n", percentile(ld, 0.5) - percentile(runtime, 0.5));
+	} catch (const std::exception & e) {
+		std::fprintf(stderr, "%s\n", e.what());
+
+		return 1;
+	}
+
+	return 0;
+}
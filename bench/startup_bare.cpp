@@ -0,0 +1,19 @@
+/*
+ * The baselines for the startup benchmark: programs that do nothing, so
+ * the time they take to run is just exec, the dynamic linker and the
+ * runtime. With LD_STARTUP_CXX defined, it also loads the C++ standard
+ * library and initializes <iostream>, like any program using the library
+ * does, so that cost can be told apart from the library's own.
+ */
+
+#ifdef LD_STARTUP_CXX
+	#include <iostream>
+#endif
+
+int main() {
+#ifdef LD_STARTUP_CXX
+	std::cout.flush();
+#endif
+
+	return 0;
+}
@@ -1,18 +1,57 @@
 #ifndef __LD_ANSI_HPP
 #define __LD_ANSI_HPP
 
+#include <memory_resource>
 #include <string>
 
+#include "ld_trace.hpp"
 #include "ld_wstr.hpp"
 
 #define LD_S static std::wstring
-#define LD_R(x) { return std::wstring(L"\033") + x; }
+#define LD_R(x) { LD_STAT(ESCAPES, 1); return std::wstring(L"\033") + x; }
 #define WTS wtostring
 #define NUM size_t
+#define LD_P static std::pmr::wstring
+#define LD_M std::pmr::memory_resource & mem
+#define LD_B(...) { return _ansi::build(mem, __VA_ARGS__); }
 
 namespace LD {
+	namespace _ansi {
+		template <class Str>
+			void put(Str & str, const wchar_t * part) {
+				str.append(part);
+			}
+
+		template <class Str>
+			void put(Str & str, NUM num) {
+				append_wnum(str, num);
+			}
+
+		/**
+		 * ESC followed by every part, allocated from `mem`.
+		 */
+		template <class... Parts>
+			std::pmr::wstring build(std::pmr::memory_resource & mem,
+			                        const Parts & ... parts) {
+				LD_STAT(ESCAPES, 1);
+
+				std::pmr::wstring built(& mem);
+
+				built.reserve(16);
+				built.append(1, L'\033');
+				(put(built, parts), ...);
+
+				return built;
+			}
+	}
+
 	/**
 	 * http://matthieu.benoit.free.fr/68hc11/vt100.htm
+	 *
+	 * Every sequence also has an overload that takes a
+	 * [[std::pmr::memory_resource]] first, like a [[LD::FrameArena]], and
+	 * allocates the string from that instead of the heap. It's taken by
+	 * reference, so a literal 0 can only mean a count, as in `c_up(0)`.
 	 */
 	struct ANSI {
 		// @formatter:off
@@ -29,6 +68,14 @@ namespace LD {
 		LD_S c_crlf()             LD_R(L"E")
 		LD_S c_rlf()              LD_R(L"M")
 		LD_S c_home()             LD_R(L"[H")
+		LD_S paste_on()           LD_R(L"[?2004h")
+		LD_S paste_off()          LD_R(L"[?2004l")
+		LD_S alt_screen_on()      LD_R(L"[?1049h")
+		LD_S alt_screen_off()     LD_R(L"[?1049l")
+		LD_S mouse_on()           LD_R(L"[?1003h\033[?1006h")
+		LD_S mouse_off()          LD_R(L"[?1006l\033[?1003l")
+		LD_S sync_on()            LD_R(L"[?2026h")
+		LD_S sync_off()           LD_R(L"[?2026l")
 		// @formatter:on
 
 		enum EraseLineEnum : NUM {
@@ -49,11 +96,43 @@ namespace LD {
 		// @formatter:on
 
 		LD_S bel() { return L"\x07"; }
+
+		// @formatter:off
+		LD_P c_up(LD_M, NUM n = 1)      LD_B(L"[", n, L"A")
+		LD_P c_down(LD_M, NUM n = 1)    LD_B(L"[", n, L"B")
+		LD_P c_forward(LD_M, NUM n = 1) LD_B(L"[", n, L"C")
+		LD_P c_back(LD_M, NUM n = 1)    LD_B(L"[", n, L"D")
+		LD_P c_mov(LD_M, NUM x, NUM y)  LD_B(L"[", y + 1, L";", x + 1, L"H")
+		LD_P c_off(LD_M)                LD_B(L"[?25l")
+		LD_P c_on(LD_M)                 LD_B(L"[?25h")
+		LD_P c_save(LD_M)               LD_B(L"7")
+		LD_P c_restore(LD_M)            LD_B(L"8")
+		LD_P c_lf(LD_M)                 LD_B(L"D")
+		LD_P c_crlf(LD_M)               LD_B(L"E")
+		LD_P c_rlf(LD_M)                LD_B(L"M")
+		LD_P c_home(LD_M)               LD_B(L"[H")
+		LD_P paste_on(LD_M)             LD_B(L"[?2004h")
+		LD_P paste_off(LD_M)            LD_B(L"[?2004l")
+		LD_P alt_screen_on(LD_M)        LD_B(L"[?1049h")
+		LD_P alt_screen_off(LD_M)       LD_B(L"[?1049l")
+		LD_P mouse_on(LD_M)             LD_B(L"[?1003h\033[?1006h")
+		LD_P mouse_off(LD_M)            LD_B(L"[?1006l\033[?1003l")
+		LD_P sync_on(LD_M)              LD_B(L"[?2026h")
+		LD_P sync_off(LD_M)             LD_B(L"[?2026l")
+
+		LD_P erase_screen(LD_M, EraseScreenEnum set) LD_B(L"[", set, L"J")
+		LD_P erase_line(LD_M, EraseLineEnum set)     LD_B(L"[", set, L"K")
+		// @formatter:on
+
+		LD_P bel(LD_M) { return std::pmr::wstring(L"\x07", & mem); }
 	};
 }
 
 #undef LD_S
 #undef LD_R
 #undef WTS
+#undef LD_P
+#undef LD_M
+#undef LD_B
 
 #endif //__LD_ANSI_HPP
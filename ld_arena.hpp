@@ -0,0 +1,148 @@
+#ifndef __LD_ARENA_HPP
+#define __LD_ARENA_HPP
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+
+namespace LD {
+	/**
+	 * A [[std::pmr::memory_resource]] that counts what it passes on to
+	 * another one.
+	 */
+	class CountingResource : public std::pmr::memory_resource {
+		public:
+			explicit CountingResource(std::pmr::memory_resource * upstream =
+			                          std::pmr::new_delete_resource())
+				: upstream(upstream) {}
+
+			/**
+			 * @return How many allocations were passed on.
+			 */
+			size_t allocations() const {
+				return count;
+			}
+
+			/**
+			 * @return How many bytes are currently allocated upstream.
+			 */
+			size_t allocated() const {
+				return bytes;
+			}
+
+		private:
+			std::pmr::memory_resource * upstream;
+			size_t                      count = 0;
+			size_t                      bytes = 0;
+
+			void * do_allocate(size_t size, size_t align) override {
+				void * ptr = upstream->allocate(size, align);
+
+				count++;
+				bytes += size;
+
+				return ptr;
+			}
+
+			void do_deallocate(void * ptr, size_t size,
+			                   size_t align) override {
+				upstream->deallocate(ptr, size, align);
+				bytes -= size;
+			}
+
+			bool do_is_equal(const std::pmr::memory_resource & other) const
+			noexcept override {
+				return this == & other;
+			}
+	};
+
+	/**
+	 * A monotonic arena for everything built while rendering one frame.
+	 * Allocating is a pointer bump, freeing does nothing, and [[reset]]
+	 * throws it all away at once after the frame is presented.
+	 *
+	 * If a frame doesn't fit, the overflow comes from the heap, and the
+	 * next [[reset]] grows the arena to fit it, so once frames stop getting
+	 * bigger, rendering doesn't touch the heap at all. [[upstream]] counts
+	 * how often that happened.
+	 *
+	 *     LD::FrameArena arena;
+	 *
+	 *     while (running) {
+	 *         auto line = LD::pad(arena.resource(), text, width);
+	 *         ...
+	 *         arena.reset();
+	 *     }
+	 */
+	class FrameArena {
+		public:
+			/**
+			 * @param capacity How many bytes to start with.
+			 */
+			explicit FrameArena(size_t capacity = 64 * 1024) {
+				allocate(capacity);
+			}
+
+			FrameArena(const FrameArena &) = delete;
+			FrameArena & operator=(const FrameArena &) = delete;
+
+			/**
+			 * @return The arena itself. Take its address for [[std::pmr]]
+			 * containers.
+			 */
+			std::pmr::memory_resource & resource() {
+				return * pool;
+			}
+
+			/**
+			 * Frees everything allocated from the arena. Nothing allocated
+			 * from it can be used afterwards.
+			 */
+			void reset() {
+				if (overflow.allocated() > 0) {
+					size_t grown = capacity + overflow.allocated();
+
+					pool.reset();
+					allocate(grown);
+				} else {
+					pool->release();
+				}
+			}
+
+			/**
+			 * @return How many bytes the arena holds before it overflows.
+			 */
+			size_t size() const {
+				return capacity;
+			}
+
+			/**
+			 * @return How many times the arena has had to go to the heap,
+			 * either to overflow or to grow.
+			 */
+			size_t upstream() const {
+				return overflow.allocations() + regrowths;
+			}
+
+		private:
+			std::unique_ptr<std::byte[]> buffer;
+			size_t                       capacity  = 0;
+			size_t                       regrowths = 0;
+			CountingResource             overflow;
+
+			std::optional<std::pmr::monotonic_buffer_resource> pool;
+
+			void allocate(size_t bytes) {
+				if (buffer) {
+					regrowths++;
+				}
+
+				buffer.reset(new std::byte[bytes]);
+				capacity = bytes;
+				pool.emplace(buffer.get(), capacity, & overflow);
+			}
+	};
+}
+
+#endif //__LD_ARENA_HPP
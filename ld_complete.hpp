@@ -0,0 +1,360 @@
+#ifndef __LD_COMPLETE_HPP
+#define __LD_COMPLETE_HPP
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "ld_mmap.hpp"
+
+namespace LD {
+	/**
+	 * A sorted prefix index of completion candidates. Looking up a prefix is
+	 * two binary searches plus however many results are asked for, no
+	 * matter how many candidates there are.
+	 *
+	 * New candidates go into a small sorted side list, which is merged into
+	 * the main one once it gets big, so adding candidates one at a time
+	 * doesn't shift the whole index every time.
+	 */
+	class CompletionIndex {
+		public:
+			CompletionIndex() = default;
+
+			/**
+			 * @param candidates Don't need to be sorted or unique.
+			 */
+			explicit CompletionIndex(std::vector<std::string> candidates)
+				: main(std::move(candidates)) {
+				std::sort(main.begin(), main.end());
+				main.erase(std::unique(main.begin(), main.end()), main.end());
+			}
+
+			void add(const std::string & candidate) {
+				if (contains(main, candidate)) {
+					return;
+				}
+
+				auto it = std::lower_bound(recent.begin(), recent.end(),
+				                           candidate);
+
+				if (it != recent.end() && * it == candidate) {
+					return;
+				}
+
+				recent.insert(it, candidate);
+
+				if (recent.size() > MERGE_AT &&
+				    recent.size() * 16 > main.size()) {
+					merge();
+				}
+			}
+
+			void remove(const std::string & candidate) {
+				erase(main, candidate);
+				erase(recent, candidate);
+			}
+
+			/**
+			 * Finds candidates that start with `prefix`, in sorted order.
+			 *
+			 * @param prefix
+			 * @param out The candidates are appended to this.
+			 * @param limit The most candidates to return.
+			 */
+			void complete(std::string_view prefix,
+			              std::vector<std::string> & out,
+			              size_t limit = 64) const {
+				auto a     = std::lower_bound(main.begin(), main.end(), prefix);
+				auto b     = std::lower_bound(recent.begin(), recent.end(),
+				                              prefix);
+				auto a_end = main.end();
+				auto b_end = recent.end();
+
+				for (size_t found = 0; found < limit; found++) {
+					bool a_ok = a != a_end && starts_with(* a, prefix);
+					bool b_ok = b != b_end && starts_with(* b, prefix);
+
+					if (a_ok && (!b_ok || * a < * b)) {
+						out.push_back(* a++);
+					} else if (b_ok) {
+						out.push_back(* b++);
+					} else {
+						break;
+					}
+				}
+			}
+
+			size_t size() const {
+				return main.size() + recent.size();
+			}
+
+		private:
+			static constexpr size_t MERGE_AT = 256;
+
+			std::vector<std::string> main;
+			std::vector<std::string> recent;
+
+			static bool starts_with(const std::string & str,
+			                        std::string_view prefix) {
+				return str.size() >= prefix.size() &&
+				       std::memcmp(str.data(), prefix.data(),
+				                   prefix.size()) == 0;
+			}
+
+			static bool contains(const std::vector<std::string> & list,
+			                     const std::string & str) {
+				return std::binary_search(list.begin(), list.end(), str);
+			}
+
+			static void erase(std::vector<std::string> & list,
+			                  const std::string & str) {
+				auto it = std::lower_bound(list.begin(), list.end(), str);
+
+				if (it != list.end() && * it == str) {
+					list.erase(it);
+				}
+			}
+
+			void merge() {
+				std::vector<std::string> merged;
+
+				merged.reserve(main.size() + recent.size());
+				std::merge(std::make_move_iterator(main.begin()),
+				           std::make_move_iterator(main.end()),
+				           std::make_move_iterator(recent.begin()),
+				           std::make_move_iterator(recent.end()),
+				           std::back_inserter(merged));
+
+				main.swap(merged);
+				recent.clear();
+			}
+	};
+
+	/**
+	 * Input history kept in an append-only file, one entry per line. What
+	 * was already in the file is memory mapped instead of read in, and each
+	 * new entry is a single append. Opening still scans the whole file
+	 * once, to find where the entries start and to build the index
+	 * [[search_back]] uses, so it takes time and memory proportional to the
+	 * size of the history.
+	 *
+	 * Entries are numbered from 0 (oldest) to [[size]] - 1 (newest).
+	 */
+	class History {
+		public:
+			/**
+			 * Throws [[std::runtime_error]] if the file can't be opened.
+			 *
+			 * @param path Created if it doesn't exist.
+			 */
+			explicit History(const std::string & path) {
+				fd = open(path.c_str(),
+				          O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0600);
+
+				if (fd < 0) {
+					throw std::runtime_error("can't open " + path);
+				}
+
+				file = MappedFile(fd, 0);
+
+				// where each line of the mapping starts
+				std::string_view data = file.view();
+				size_t           pos  = 0;
+
+				// the last line was cut off, so the next entry would be
+				// glued onto it
+				unterminated = !data.empty() && data.back() != '\n';
+
+				while (pos < data.size()) {
+					size_t nl = data.find('\n', pos);
+
+					if (nl == std::string_view::npos) {
+						nl = data.size();
+					}
+
+					if (nl > pos) {
+						entries.push_back(data.substr(pos, nl - pos));
+						index(entries.size() - 1);
+					}
+
+					pos = nl + 1;
+				}
+			}
+
+			~History() {
+				if (fd >= 0) {
+					close(fd);
+				}
+			}
+
+			History(const History &) = delete;
+			History & operator=(const History &) = delete;
+
+			/**
+			 * Appends an entry. Newlines are replaced with spaces, and empty
+			 * entries or repeats of the newest entry are ignored.
+			 *
+			 * @param line
+			 */
+			void add(std::string line) {
+				std::replace(line.begin(), line.end(), '\n', ' ');
+
+				if (line.empty() ||
+				    (!entries.empty() && entries.back() == line)) {
+					return;
+				}
+
+				added.push_back(line);
+				entries.push_back(added.back());
+				index(entries.size() - 1);
+
+				line.push_back('\n');
+
+				if (unterminated) {
+					line.insert(line.begin(), '\n');
+					unterminated = false;
+				}
+
+				const char * data = line.data();
+				size_t       left = line.size();
+
+				while (left > 0) {
+					ssize_t wrote = write(fd, data, left);
+
+					if (wrote < 0 && errno == EINTR) {
+						continue;
+					} else if (wrote <= 0) {
+						break;
+					}
+
+					data += wrote;
+					left -= static_cast<size_t>(wrote);
+				}
+			}
+
+			size_t size() const {
+				return entries.size();
+			}
+
+			std::string_view operator[](size_t i) const {
+				return entries[i];
+			}
+
+			/**
+			 * Searches backwards from entry `before` - 1 for an entry that
+			 * contains `query`, like Ctrl+R in a shell. To find the next
+			 * older match, search again with the index of this one.
+			 *
+			 * Queries of three or more bytes only look at the entries that
+			 * contain the query's rarest trigram. Shorter queries check
+			 * every entry until one matches, which is quick since short
+			 * queries match often.
+			 *
+			 * @param query
+			 * @param before [[size]] to start from the newest entry.
+			 * @param found Where to put the index of the match.
+			 * @return Whether anything matched
+			 */
+			bool search_back(std::string_view query, size_t before,
+			                 size_t & found) const {
+				if (before > entries.size()) {
+					before = entries.size();
+				}
+
+				if (query.size() >= 3) {
+					const std::vector<uint32_t> * rarest = nullptr;
+
+					for (size_t j = 0; j + 3 <= query.size(); j++) {
+						auto it = trigrams.find(trigram(query, j));
+
+						if (it == trigrams.end()) {
+							return false;
+						}
+
+						if (rarest == nullptr ||
+						    it->second.size() < rarest->size()) {
+							rarest = & it->second;
+						}
+					}
+
+					auto end = std::lower_bound(rarest->begin(), rarest->end(),
+					                            before);
+
+					while (end != rarest->begin()) {
+						--end;
+
+						if (entries[* end].find(query) != std::string_view::npos) {
+							found = * end;
+
+							return true;
+						}
+					}
+
+					return false;
+				}
+
+				while (before > 0) {
+					before--;
+
+					if (entries[before].find(query) != std::string_view::npos) {
+						found = before;
+
+						return true;
+					}
+				}
+
+				return false;
+			}
+
+		private:
+			int        fd = -1;
+			MappedFile file;
+
+			/**
+			 * Entries added since the file was opened. Growing a deque
+			 * doesn't move its elements, so [[entries]] can point into it.
+			 */
+			std::deque<std::string> added;
+
+			std::vector<std::string_view> entries;
+
+			/**
+			 * The entries each trigram shows up in, oldest first.
+			 */
+			std::unordered_map<uint32_t, std::vector<uint32_t>> trigrams;
+
+			bool unterminated = false;
+
+			static uint32_t trigram(std::string_view str, size_t i) {
+				return (uint32_t(uint8_t(str[i])) << 16) |
+				       (uint32_t(uint8_t(str[i + 1])) << 8) |
+				       uint32_t(uint8_t(str[i + 2]));
+			}
+
+			void index(size_t i) {
+				std::string_view entry = entries[i];
+
+				for (size_t j = 0; j + 3 <= entry.size(); j++) {
+					auto & ids = trigrams[trigram(entry, j)];
+
+					// the same trigram can show up twice in one entry
+					if (ids.empty() || ids.back() != i) {
+						ids.push_back(static_cast<uint32_t>(i));
+					}
+				}
+			}
+	};
+}
+
+#endif //__LD_COMPLETE_HPP
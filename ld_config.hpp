@@ -0,0 +1,33 @@
+#ifndef __LD_CONFIG_HPP
+#define __LD_CONFIG_HPP
+
+/*
+ * The library is header-only by default. Define LD_SEPARATE_COMPILATION
+ * (the CMake `ld_boilerplate` target does) to make the headers only
+ * declare the heavier non-template functions, like [[LD::s2wstr]],
+ * [[LD::tabulate]] and [[LD::TUI::getch]], so they're compiled once, in
+ * src/ld_boilerplate.cpp, instead of in every translation unit.
+ *
+ * Those functions are marked with LD_DECL, which is `inline` when the
+ * library is header-only, and their definitions are at the bottom of each
+ * header, behind `#if LD_DEFINITIONS`. So are the includes only they need,
+ * like <iostream>, termcolor and linenoise; include ld_termcolor.hpp
+ * yourself for LOG_STYLE and the other style macros.
+ */
+
+// @formatter:off
+#ifdef LD_SEPARATE_COMPILATION
+	#define LD_DECL
+
+	#ifdef LD_BUILDING_LIBRARY
+		#define LD_DEFINITIONS 1
+	#else
+		#define LD_DEFINITIONS 0
+	#endif
+#else
+	#define LD_DECL inline
+	#define LD_DEFINITIONS 1
+#endif
+// @formatter:on
+
+#endif //__LD_CONFIG_HPP
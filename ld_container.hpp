@@ -1,34 +1,242 @@
 #ifndef __LD_CONTAINER_HPP
 #define __LD_CONTAINER_HPP
 
+#include <charconv>
+#include <cstdint>
+#include <iterator>
 #include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
 
 #include "ld_wstr.hpp"
 
 namespace LD {
+	namespace _container {
+		template <class T, class = void>
+			struct is_range : std::false_type {};
+
+		template <class T>
+			struct is_range<T, std::void_t<
+				decltype(std::begin(std::declval<const T &>())),
+				decltype(std::end(std::declval<const T &>()))
+			>> : std::true_type {};
+
+		template <class T, class = void>
+			struct has_size : std::false_type {};
+
+		template <class T>
+			struct has_size<T, std::void_t<
+				decltype(std::size(std::declval<const T &>()))
+			>> : std::true_type {};
+
+		template <class T, class = void>
+			struct is_map : std::false_type {};
+
+		template <class T>
+			struct is_map<T, std::void_t<
+				typename T::key_type, typename T::mapped_type
+			>> : std::true_type {};
+
+		template <class T, class = void>
+			struct is_set : std::false_type {};
+
+		template <class T>
+			struct is_set<T, std::void_t<typename T::key_type>>
+				: std::bool_constant<!is_map<T>::value> {};
+
+		template <class T>
+			struct is_pair : std::false_type {};
+
+		template <class A, class B>
+			struct is_pair<std::pair<A, B>> : std::true_type {};
+
+		template <class Sink, class = void>
+			struct is_stream : std::false_type {};
+
+		template <class Sink>
+			struct is_stream<Sink, std::void_t<decltype(
+				std::declval<Sink &>().write(
+					std::declval<const wchar_t *>(), std::streamsize()
+				)
+			)>> : std::true_type {};
+
+		template <class Sink, class = void>
+			struct has_reserve : std::false_type {};
+
+		template <class Sink>
+			struct has_reserve<Sink, std::void_t<
+				decltype(std::declval<Sink &>().reserve(size_t()))
+			>> : std::true_type {};
+
+		template <class Sink>
+			void append(Sink & sink, const wchar_t * str, size_t len) {
+				if constexpr (is_stream<Sink>::value) {
+					sink.write(str, static_cast<std::streamsize>(len));
+				} else {
+					sink.append(str, len);
+				}
+			}
+
+		template <class Sink, size_t N>
+			void append(Sink & sink, const wchar_t (& str)[N]) {
+				append(sink, str, N - 1);
+			}
+
+		/**
+		 * Writes a number without going through a temporary
+		 * [[std::wstring]] like [[LD::wtostring]] does.
+		 */
+		template <class Sink, class Num>
+			void append_number(Sink & sink, Num num) {
+				char    buf[64];
+				wchar_t wbuf[64];
+
+				auto result = std::to_chars(buf, buf + sizeof(buf), num);
+				auto len    = static_cast<size_t>(result.ptr - buf);
+
+				for (size_t i = 0; i < len; i++) {
+					wbuf[i] = buf[i];
+				}
+
+				append(sink, wbuf, len);
+			}
+
+		template <class Sink, class T>
+			void format_value(Sink & sink, const T & value, size_t cap);
+
+		template <class Sink, class Range>
+			void format_range(Sink & sink, const Range & range, size_t cap) {
+				constexpr bool braces = is_map<Range>::value ||
+				                        is_set<Range>::value;
+
+				append(sink, braces ? L"{" : L"[", 1);
+
+				auto   it    = std::begin(range);
+				auto   end   = std::end(range);
+				size_t count = 0;
+
+				for (; it != end && count < cap; ++it, ++count) {
+					if (count > 0) {
+						append(sink, L", ");
+					}
+
+					if constexpr (is_map<Range>::value) {
+						format_value(sink, it->first, cap);
+						append(sink, L": ");
+						format_value(sink, it->second, cap);
+					} else {
+						format_value(sink, * it, cap);
+					}
+				}
+
+				if (it != end) {
+					if (count > 0) {
+						append(sink, L", …");
+					} else {
+						append(sink, L"…");
+					}
+
+					/*
+					 * only count what's left if the range can tell us for
+					 * free, anything else would make this O(n) again
+					 */
+					if constexpr (has_size<Range>::value) {
+						append(sink, L" ");
+						append_number(sink, static_cast<uint64_t>(
+							std::size(range) - count
+						));
+						append(sink, L" more");
+					}
+				}
+
+				append(sink, braces ? L"}" : L"]", 1);
+			}
+
+		template <class Sink, class T>
+			void format_value(Sink & sink, const T & value, size_t cap) {
+				if constexpr (std::is_same<T, bool>::value) {
+					// 1 and 0, like wtostring, but to_chars has no bool
+					append(sink, value ? L"1" : L"0", 1);
+				} else if constexpr (std::is_arithmetic<T>::value) {
+					// chars included, as numbers, like wtostring does
+					append_number(sink, value);
+				} else if constexpr (std::is_convertible<
+					const T &, std::wstring_view
+				>::value) {
+					std::wstring_view view = value;
+
+					append(sink, view.data(), view.size());
+				} else if constexpr (std::is_convertible<
+					const T &, std::string_view
+				>::value) {
+					std::wstring wide = s2wstr(std::string(value));
+
+					append(sink, wide.data(), wide.size());
+				} else if constexpr (is_pair<T>::value) {
+					append(sink, L"(");
+					format_value(sink, value.first, cap);
+					append(sink, L", ");
+					format_value(sink, value.second, cap);
+					append(sink, L")");
+				} else if constexpr (is_range<T>::value) {
+					format_range(sink, value, cap);
+				} else {
+					std::wstring str = wtostring(value);
+
+					append(sink, str.data(), str.size());
+				}
+			}
+	}
+
 	/**
-	 * Converts a container to a string like [1, 2, 3].
+	 * Writes a container to `sink` like [1, 2, 3]. Works with anything that
+	 * has begin() and end(), including nested containers. Maps come out
+	 * like {1: a, 2: b} and sets like {1, 2}.
+	 *
+	 * At most `cap` elements of each container are written, and the rest are
+	 * summarized, like [1, 2, 3, … 9999997 more], so huge containers take
+	 * O(cap) time.
 	 *
+	 * @tparam Sink A [[std::wstring]], a [[std::wostream]], or anything else
+	 * with an `append(const wchar_t *, size_t)`.
 	 * @tparam Container
+	 * @param sink
 	 * @param cont
-	 * @return
+	 * @param cap The maximum number of elements to write per container.
+	 * @return `sink`
 	 */
-	template <class Container>
-		std::wstring wstr_container(const Container & cont) {
-			if (cont.size() == 0) {
-				return L"[]";
+	template <class Sink, class Container>
+		Sink & format_container(Sink & sink, const Container & cont,
+		                        size_t cap = SIZE_MAX) {
+			if constexpr (_container::has_reserve<Sink>::value &&
+			              _container::has_size<Container>::value) {
+				// rough guess: a few characters per element plus separators
+				size_t shown = std::size(cont) < cap ? std::size(cont) : cap;
+
+				sink.reserve(sink.size() + shown * 4 + 32);
 			}
 
-			std::wstring built = L"[";
+			_container::format_range(sink, cont, cap);
 
-			for (int i = 0; i < cont.size(); i++) {
-				built.append(wtostring(cont[i]) + L", ");
-			}
+			return sink;
+		}
 
-			auto end = built.end();
-			* (-- --end) = L']';
+	/**
+	 * Converts a container to a string like [1, 2, 3]. See
+	 * [[LD::format_container]].
+	 *
+	 * @tparam Container
+	 * @param cont
+	 * @param cap The maximum number of elements to write per container.
+	 * @return
+	 */
+	template <class Container>
+		std::wstring wstr_container(const Container & cont,
+		                            size_t cap = SIZE_MAX) {
+			std::wstring built;
 
-			return built.substr(0, built.length() - 1);
+			return format_container(built, cont, cap);
 		}
 }
 
@@ -0,0 +1,552 @@
+#ifndef __LD_CSV_HPP
+#define __LD_CSV_HPP
+
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// @formatter:off
+#ifdef __SSE2__
+	#include <emmintrin.h>
+#endif
+// @formatter:on
+
+#include "ld_config.hpp"
+#include "ld_mmap.hpp"
+#include "ld_trace.hpp"
+#include "ld_wstr.hpp"
+
+namespace LD {
+	/**
+	 * A CSV or TSV file, parsed in place. The file is memory mapped and
+	 * every cell is a [[std::string_view]] into the mapping; the only cells
+	 * that get copied are quoted ones with escaped quotes ("") in them,
+	 * which have to be unescaped.
+	 *
+	 * Quoted cells can contain the separator and newlines. Rows can have
+	 * different numbers of cells, missing ones read as empty. Blank lines
+	 * are skipped, and CRLF line endings are fine.
+	 *
+	 *     LD::CsvTable table("export.csv");
+	 *
+	 *     LD::o(LD::render_tabulated(table));
+	 */
+	class CsvTable {
+		public:
+			/**
+			 * Maps and parses the file at `path`. Throws
+			 * [[std::runtime_error]] if it can't be mapped.
+			 *
+			 * @param path
+			 * @param sep The separator, or 0 to use a tab if the first line
+			 * has one and a comma otherwise.
+			 */
+			explicit CsvTable(const std::string & path, char sep = 0)
+				: file(path) {
+				parse(file.view(), sep);
+			}
+
+			/**
+			 * Parses text that's already in memory, like something read from
+			 * a pipe. The table keeps the text.
+			 *
+			 * @param text
+			 * @param sep See above.
+			 * @return
+			 */
+			static CsvTable from_string(std::string text, char sep = 0) {
+				CsvTable table;
+
+				table.owned = std::make_unique<std::string>(std::move(text));
+				table.parse(* table.owned, sep);
+
+				return table;
+			}
+
+			CsvTable(CsvTable &&) = default;
+			CsvTable & operator=(CsvTable &&) = default;
+
+			size_t rows() const {
+				return row_starts.size();
+			}
+
+			/**
+			 * @return The number of cells in the longest row.
+			 */
+			size_t columns() const {
+				return width;
+			}
+
+			char separator() const {
+				return sep;
+			}
+
+			/**
+			 * @param row
+			 * @param col
+			 * @return The cell, as UTF-8, or an empty view if the row is too
+			 * short
+			 */
+			std::string_view cell(size_t row, size_t col) const {
+				size_t start = row_starts[row];
+				size_t end   = row + 1 < row_starts.size() ? row_starts[row + 1]
+				                                           : cells.size();
+
+				return start + col < end ? cells[start + col]
+				                         : std::string_view();
+			}
+
+			/**
+			 * Whether every cell in `col` is a number, apart from maybe the
+			 * first row (which is usually a header) and empty cells.
+			 * Numeric columns are right-aligned by [[LD::render_tabulated]].
+			 *
+			 * @param col
+			 * @return
+			 */
+			bool numeric(size_t col) const {
+				return col < numeric_cols.size() && numeric_cols[col];
+			}
+
+			/**
+			 * @param str
+			 * @return Whether `str` looks like a decimal number, like `-12`,
+			 * `3.5`, `.5` or `1e-9`
+			 */
+			static bool is_number(std::string_view str);
+
+		private:
+			MappedFile file;
+			char       sep   = ',';
+			size_t     width = 0;
+
+			/**
+			 * Text from [[from_string]]. On the heap, so the cells still
+			 * point at it after the table is moved.
+			 */
+			std::unique_ptr<std::string> owned;
+
+			std::vector<std::string_view> cells;
+			std::vector<size_t>           row_starts;
+			std::vector<bool>             numeric_cols;
+
+			/**
+			 * Where unescaped copies of quoted cells live. Growing a deque
+			 * doesn't move its elements, so [[cells]] can point into it.
+			 */
+			std::deque<std::string> unescaped;
+
+			CsvTable() = default;
+
+			static size_t skip_digits(std::string_view str, size_t & i) {
+				size_t start = i;
+
+				while (i < str.size() && str[i] >= '0' && str[i] <= '9') {
+					i++;
+				}
+
+				return i - start;
+			}
+
+			/**
+			 * Finds the next separator or newline. This is where parsing
+			 * spends its time, so with SSE2 it checks 16 bytes at once.
+			 *
+			 * @return `end` if there isn't one
+			 */
+			static const char * find_break(const char * pos, const char * end,
+			                               char sep);
+
+			void parse(std::string_view data, char separator);
+
+			/**
+			 * Parses a quoted cell, starting just after the opening quote.
+			 *
+			 * @return Where the cell ends, at the separator or newline after
+			 * it
+			 */
+			const char * parse_quoted(const char * pos, const char * end);
+
+			void finish_row() {
+				size_t count = cells.size() - row_starts.back();
+
+				if (count > width) {
+					width = count;
+				}
+			}
+
+			void infer_types();
+	};
+
+	/**
+	 * Draws a [[LD::CsvTable]] the same way as [[LD::render_tabulated]]
+	 * draws the output of [[LD::tabulate]], straight from the mapped file,
+	 * without building a table of wide strings first. Numeric columns are
+	 * right-aligned.
+	 *
+	 * @param table
+	 * @return
+	 */
+	LD_DECL std::wstring render_tabulated(const CsvTable & table);
+}
+
+#if LD_DEFINITIONS
+namespace LD {
+	namespace _csv {
+		/**
+		 * Converts a cell to a wide string in `wide`, with any newlines in
+		 * it turned into spaces so they don't break the table. A cell that
+		 * isn't valid UTF-8 has every non-ASCII byte replaced with '?'
+		 * instead, like the lines of a [[LD::Scrollback]].
+		 */
+		inline void widen(std::wstring & wide, std::string_view text) {
+			wide.clear();
+
+			try {
+				s2wstr(text, wide);
+			} catch (const std::range_error &) {
+				wide.clear();
+
+				for (char ch : text) {
+					wide.push_back(static_cast<unsigned char>(ch) < 0x80
+					               ? static_cast<wchar_t>(ch) : L'?');
+				}
+			}
+
+			for (wchar_t & ch : wide) {
+				if (ch == L'\n' || ch == L'\r') {
+					ch = L' ';
+				}
+			}
+		}
+
+		/**
+		 * @return How many characters `text` takes up once it's a wide
+		 * string, which is what the table is measured in. Only cells that
+		 * aren't plain ASCII are converted (into `wide`) to find out.
+		 */
+		inline size_t width(std::wstring & wide, std::string_view text) {
+			for (char ch : text) {
+				if (static_cast<unsigned char>(ch) >= 0x80) {
+					widen(wide, text);
+
+					return wide.size();
+				}
+			}
+
+			return text.size();
+		}
+
+		/**
+		 * Appends `text` padded to `cols`, converted by [[widen]].
+		 */
+		inline void put_cell(std::wstring & out, std::wstring & wide,
+		                     std::string_view text, size_t cols, bool lpad) {
+			widen(wide, text);
+
+			size_t fill = cols - wide.size();
+
+			if (lpad) {
+				out.append(fill, L' ');
+			}
+
+			out.append(wide);
+
+			if (!lpad) {
+				out.append(fill, L' ');
+			}
+		}
+
+		inline void put_border(std::wstring & out,
+		                       const std::vector<size_t> & cols,
+		                       const wchar_t * left, const wchar_t * mid,
+		                       const wchar_t * right) {
+			out.append(left);
+
+			for (size_t i = 0; i < cols.size(); i++) {
+				out.append(cols[i] + 2, L'─');
+				out.append(i == cols.size() - 1 ? right : mid);
+			}
+		}
+	}
+
+	LD_DECL bool CsvTable::is_number(std::string_view str) {
+		size_t i = 0;
+
+		if (i < str.size() && (str[i] == '-' || str[i] == '+')) {
+			i++;
+		}
+
+		size_t digits = skip_digits(str, i);
+
+		if (i < str.size() && str[i] == '.') {
+			i++;
+			digits += skip_digits(str, i);
+		}
+
+		if (digits == 0) {
+			return false;
+		}
+
+		if (i < str.size() && (str[i] == 'e' || str[i] == 'E')) {
+			i++;
+
+			if (i < str.size() && (str[i] == '-' || str[i] == '+')) {
+				i++;
+			}
+
+			if (skip_digits(str, i) == 0) {
+				return false;
+			}
+		}
+
+		return i == str.size();
+	}
+
+	LD_DECL const char * CsvTable::find_break(const char * pos, const char * end,
+	                                          char sep) {
+		// @formatter:off
+	#ifdef __SSE2__
+		const __m128i seps     = _mm_set1_epi8(sep);
+		const __m128i newlines = _mm_set1_epi8('\n');
+
+		for (; end - pos >= 16; pos += 16) {
+			__m128i chunk = _mm_loadu_si128(
+				reinterpret_cast<const __m128i *>(pos)
+			);
+
+			int mask = _mm_movemask_epi8(_mm_or_si128(
+				_mm_cmpeq_epi8(chunk, seps),
+				_mm_cmpeq_epi8(chunk, newlines)
+			));
+
+			if (mask != 0) {
+				return pos + __builtin_ctz(static_cast<unsigned>(mask));
+			}
+		}
+	#endif
+		// @formatter:on
+
+		for (; pos < end; pos++) {
+			if (* pos == sep || * pos == '\n') {
+				return pos;
+			}
+		}
+
+		return end;
+	}
+
+	LD_DECL void CsvTable::parse(std::string_view data, char separator) {
+		LD_TRACE_SCOPE("LD::CsvTable::parse");
+
+		const char * pos = data.data();
+		const char * end = pos + data.size();
+
+		if (separator == 0) {
+			const char * nl = static_cast<const char *>(
+				std::memchr(pos, '\n', data.size())
+			);
+
+			separator = std::memchr(pos, '\t', (nl ? nl : end) - pos)
+			            ? '\t' : ',';
+		}
+
+		sep = separator;
+
+		// a rough guess, to save most of the regrowing
+		cells.reserve(data.size() / 8);
+
+		bool row_open = false;
+
+		while (pos < end) {
+			if (!row_open) {
+				// skip blank lines
+				if (* pos == '\n' || (* pos == '\r' && pos + 1 < end &&
+				                      pos[1] == '\n')) {
+					pos += * pos == '\r' ? 2 : 1;
+
+					continue;
+				}
+
+				row_starts.push_back(cells.size());
+				row_open = true;
+			}
+
+			if (* pos == '"') {
+				pos = parse_quoted(pos + 1, end);
+			} else {
+				const char * brk  = find_break(pos, end, sep);
+				const char * stop = brk;
+
+				if (stop > pos && stop[-1] == '\r' &&
+				    (stop == end || * stop == '\n')) {
+					stop--;
+				}
+
+				cells.emplace_back(pos, static_cast<size_t>(stop - pos));
+				pos = brk;
+			}
+
+			if (pos < end && * pos == sep) {
+				pos++;
+
+				// a separator at the very end still means one more
+				if (pos == end) {
+					cells.emplace_back();
+				}
+			} else {
+				// newline or end of input
+				if (pos < end) {
+					pos++;
+				}
+
+				finish_row();
+				row_open = false;
+			}
+		}
+
+		if (row_open) {
+			finish_row();
+		}
+
+		infer_types();
+	}
+
+	LD_DECL const char * CsvTable::parse_quoted(const char * pos,
+	                                            const char * end) {
+		const char * start   = pos;
+		bool         escaped = false;
+
+		while (true) {
+			const char * quote = static_cast<const char *>(
+				std::memchr(pos, '"', static_cast<size_t>(end - pos))
+			);
+
+			if (quote == nullptr) {
+				// never closed, take the rest
+				cells.emplace_back(start,
+				                   static_cast<size_t>(end - start));
+
+				return end;
+			}
+
+			if (quote + 1 < end && quote[1] == '"') {
+				escaped = true;
+				pos     = quote + 2;
+
+				continue;
+			}
+
+			std::string_view text(start,
+			                      static_cast<size_t>(quote - start));
+
+			if (escaped) {
+				std::string copy;
+
+				copy.reserve(text.size());
+
+				for (size_t i = 0; i < text.size(); i++) {
+					copy.push_back(text[i]);
+
+					if (text[i] == '"') {
+						i++;
+					}
+				}
+
+				unescaped.push_back(std::move(copy));
+				text = unescaped.back();
+			}
+
+			cells.push_back(text);
+
+			// anything between the closing quote and the separator
+			// is ignored
+			return find_break(quote + 1, end, sep);
+		}
+	}
+
+	LD_DECL void CsvTable::infer_types() {
+		numeric_cols.assign(width, false);
+
+		for (size_t col = 0; col < width; col++) {
+			bool   numeric = true;
+			size_t numbers = 0;
+
+			for (size_t row = 0; row < rows() && numeric; row++) {
+				std::string_view text = cell(row, col);
+
+				if (text.empty()) {
+					continue;
+				}
+
+				if (is_number(text)) {
+					numbers++;
+				} else if (row > 0) {
+					numeric = false;
+				}
+			}
+
+			numeric_cols[col] = numeric && numbers > 0;
+		}
+	}
+
+	LD_DECL std::wstring render_tabulated(const CsvTable & table) {
+		LD_TRACE_SCOPE("LD::render_tabulated(CsvTable)");
+
+		std::wstring result;
+
+		if (table.rows() == 0) {
+			return result;
+		}
+
+		std::vector<size_t> cols(table.columns(), 0);
+		size_t              total = 0;
+		std::wstring        wide;
+
+		for (size_t row = 0; row < table.rows(); row++) {
+			for (size_t col = 0; col < cols.size(); col++) {
+				size_t chars = _csv::width(wide, table.cell(row, col));
+
+				if (chars > cols[col]) {
+					cols[col] = chars;
+				}
+			}
+		}
+
+		LD_STAT(CELLS_RENDERED, table.rows() * cols.size());
+
+		for (size_t col : cols) {
+			total += col + 3;
+		}
+
+		result.reserve((total + 2) * (table.rows() * 2 + 1));
+
+		_csv::put_border(result, cols, L"┌", L"┬", L"┐\n");
+
+		for (size_t row = 0; row < table.rows(); row++) {
+			result.append(L"│");
+
+			for (size_t col = 0; col < cols.size(); col++) {
+				result.append(L" ");
+				_csv::put_cell(result, wide, table.cell(row, col), cols[col],
+				               table.numeric(col));
+				result.append(L" │");
+			}
+
+			if (row == table.rows() - 1) {
+				_csv::put_border(result, cols, L"\n└", L"┴", L"┘");
+			} else {
+				_csv::put_border(result, cols, L"\n├", L"┼", L"┤\n");
+			}
+		}
+
+		return result;
+	}
+}
+#endif
+
+#endif //__LD_CSV_HPP
@@ -0,0 +1,720 @@
+#ifndef __LD_EVENT_HPP
+#define __LD_EVENT_HPP
+
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <deque>
+#include <string>
+#include <vector>
+
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+	#include <coroutine>
+	#define LD_USE_COROUTINES
+#endif
+
+#include "ld_tui.hpp"
+
+namespace LD {
+	namespace TUI {
+		/**
+		 * Something that happened while waiting in an [[LD::TUI::EventLoop]].
+		 */
+		struct Event {
+			enum Type {
+				KEY,      // a key was decoded, see `key`
+				RESIZE,   // the terminal changed size, see `width`/`height`
+				TICK,     // a timer fired, see `timer`
+				FD_READY, // a watched fd is ready, see `fd` and `revents`
+				SIGNAL,   // SIGINT was caught, see `signal`
+				CLOSED,   // stdin was closed
+				PASTE,    // something was pasted, see `text`
+				MOUSE     // the mouse did something, see `mouse`
+			};
+
+			Type      type    = KEY;
+			Keys::Key key     = Keys::NUL;
+			size_t    width   = 0;
+			size_t    height  = 0;
+			size_t    timer   = 0;
+			int       fd      = -1;
+			short     revents = 0;
+			int       signal  = 0;
+
+			/**
+			 * The pasted text, as UTF-8, exactly as the terminal sent it.
+			 */
+			std::string text;
+
+			Mouse mouse;
+
+			/**
+			 * How far the mouse moved since the last mouse event. Once motion
+			 * events are coalesced, this is the sum of all of them.
+			 */
+			long dx = 0;
+			long dy = 0;
+
+			/**
+			 * How many events were coalesced into this one. See
+			 * [[LD::TUI::EventLoop::Coalesce]].
+			 */
+			size_t count = 1;
+		};
+
+		// @formatter:off
+	#ifdef LD_USE_COROUTINES
+		/**
+		 * The return type of coroutines driven by [[LD::TUI::EventLoop]].
+		 * They start running immediately and clean up after themselves, so
+		 * there's nothing to hold on to.
+		 */
+		struct Task {
+			struct promise_type {
+				Task get_return_object() {
+					return {};
+				}
+
+				std::suspend_never initial_suspend() noexcept {
+					return {};
+				}
+
+				std::suspend_never final_suspend() noexcept {
+					return {};
+				}
+
+				void return_void() {}
+
+				void unhandled_exception() {
+					std::terminate();
+				}
+			};
+		};
+	#endif
+		// @formatter:on
+
+		/**
+		 * Waits on stdin, timers, signals and any other file descriptors at
+		 * once with [[poll]], so a TUI can update a clock or react to a
+		 * resize while waiting for a key. Nothing runs while there's nothing
+		 * to do: the loop sleeps in [[poll]] until the next timer is due or
+		 * something arrives.
+		 *
+		 * The terminal is in raw mode for as long as the loop exists, and
+		 * SIGINT is delivered as an event instead of killing the process.
+		 * Only one loop can exist at a time.
+		 *
+		 *     LD::TUI::EventLoop loop;
+		 *     loop.add_timer(std::chrono::seconds(1));
+		 *
+		 *     while (true) {
+		 *         LD::TUI::Event event = loop.next();
+		 *         ...
+		 *     }
+		 */
+		class EventLoop {
+			public:
+				using clock = std::chrono::steady_clock;
+
+				explicit EventLoop(bool catch_sigint = true) {
+					if (pipe(signal_pipe) == 0) {
+						for (int fd : signal_pipe) {
+							fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+							fcntl(fd, F_SETFD, FD_CLOEXEC);
+						}
+
+						signal_fd() = signal_pipe[1];
+					}
+
+					struct sigaction action {};
+					action.sa_handler = on_signal;
+					action.sa_flags   = SA_RESTART;
+					sigemptyset(& action.sa_mask);
+
+					sigaction(SIGWINCH, & action, & old_winch);
+
+					if (catch_sigint) {
+						sigaction(SIGINT, & action, & old_int);
+						caught_int = true;
+					}
+				}
+
+				~EventLoop() {
+					sigaction(SIGWINCH, & old_winch, nullptr);
+
+					if (caught_int) {
+						sigaction(SIGINT, & old_int, nullptr);
+					}
+
+					signal_fd() = -1;
+
+					close(signal_pipe[0]);
+					close(signal_pipe[1]);
+				}
+
+				EventLoop(const EventLoop &) = delete;
+				EventLoop & operator=(const EventLoop &) = delete;
+
+				/**
+				 * Adds a timer that delivers a [[LD::TUI::Event::TICK]] every
+				 * `interval`, or just once if `repeat` is false.
+				 *
+				 * @param interval
+				 * @param repeat
+				 * @return The timer's ID, which ends up in
+				 * [[LD::TUI::Event::timer]].
+				 */
+				size_t add_timer(clock::duration interval, bool repeat = true) {
+					size_t id = ++last_timer;
+
+					timers.push_back({id, interval, clock::now() + interval,
+					                  repeat});
+
+					return id;
+				}
+
+				void remove_timer(size_t id) {
+					timers.erase(
+						std::remove_if(timers.begin(), timers.end(),
+						               [=](const Timer & timer) {
+							               return timer.id == id;
+						               }),
+						timers.end()
+					);
+				}
+
+				/**
+				 * Delivers a [[LD::TUI::Event::FD_READY]] whenever `fd` has
+				 * any of `events`. The loop doesn't read from it, that's up to
+				 * whoever handles the event, otherwise it'll just fire again.
+				 *
+				 * @param fd
+				 * @param events
+				 */
+				void watch(int fd, short events = POLLIN) {
+					unwatch(fd);
+					watched.push_back({fd, events, 0});
+				}
+
+				void unwatch(int fd) {
+					watched.erase(
+						std::remove_if(watched.begin(), watched.end(),
+						               [=](const pollfd & pfd) {
+							               return pfd.fd == fd;
+						               }),
+						watched.end()
+					);
+				}
+
+				/**
+				 * Waits up to `timeout_ms` for an event. A negative timeout
+				 * waits forever, 0 just checks.
+				 *
+				 * @param event Where to put the event.
+				 * @param timeout_ms
+				 * @return false if nothing happened in time
+				 */
+				bool poll(Event & event, int timeout_ms) {
+					auto deadline = clock::now() +
+					                std::chrono::milliseconds(timeout_ms);
+
+					while (pending.empty()) {
+						decode_input(false);
+
+						if (!pending.empty()) {
+							break;
+						}
+
+						auto now  = clock::now();
+						int  wait = timeout_ms < 0 ? -1 : until(now, deadline);
+
+						for (const Timer & timer : timers) {
+							wait = min_wait(wait, until(now, timer.deadline));
+						}
+
+						if (incomplete) {
+							wait = min_wait(wait, until(now, escape_deadline));
+						}
+
+						wait_once(wait);
+
+						now = clock::now();
+
+						if (incomplete && now >= escape_deadline) {
+							decode_input(true);
+						}
+
+						fire_timers(now);
+
+						if (pending.empty() && timeout_ms >= 0 &&
+						    now >= deadline) {
+							return false;
+						}
+					}
+
+					event = std::move(pending.front());
+					pending.pop_front();
+
+					return true;
+				}
+
+				/**
+				 * @return Whether [[poll]] has another event ready right now,
+				 * without waiting. Handy for only redrawing once the events
+				 * that have already arrived are all handled.
+				 */
+				bool has_pending() {
+					if (pending.empty()) {
+						decode_input(false);
+					}
+
+					return !pending.empty();
+				}
+
+				/**
+				 * Waits for the next event, however long it takes.
+				 *
+				 * @return
+				 */
+				Event next() {
+					Event event;
+
+					while (!poll(event, -1)) {}
+
+					return event;
+				}
+
+				// @formatter:off
+			#ifdef LD_USE_COROUTINES
+				/**
+				 * `co_await loop.next_event()` suspends the coroutine until
+				 * any event arrives.
+				 */
+				auto next_event() {
+					return Awaiter<Event>(* this, Waiter::ANY);
+				}
+
+				/**
+				 * `co_await loop.next_key()` suspends the coroutine until a
+				 * key arrives.
+				 */
+				auto next_key() {
+					return Awaiter<Keys::Key>(* this, Waiter::KEY);
+				}
+
+				/**
+				 * `co_await loop.sleep(...)` suspends the coroutine for
+				 * `duration`, without holding up anything else.
+				 */
+				auto sleep(clock::duration duration) {
+					return Awaiter<void>(* this, Waiter::TIMER,
+					                     add_timer(duration, false));
+				}
+
+				/**
+				 * Runs the loop, resuming coroutines as their events arrive,
+				 * until [[stop]] is called or no coroutines are waiting.
+				 */
+				void run() {
+					running = true;
+
+					while (running && !waiters.empty()) {
+						dispatch(next());
+					}
+				}
+
+				void stop() {
+					running = false;
+				}
+			#endif
+				// @formatter:on
+
+				/**
+				 * How to merge events when they arrive faster than they're
+				 * handled, so that a consumer that redraws per event is
+				 * bounded by its frame time and not by the input rate.
+				 */
+				struct Coalesce {
+					/**
+					 * Merge runs of the same key (like a held arrow key) into
+					 * one event, with [[LD::TUI::Event::count]] set.
+					 */
+					bool repeats = false;
+
+					/**
+					 * Merge runs of mouse motion into one event at the latest
+					 * position, with the movement summed in
+					 * [[LD::TUI::Event::dx]] and [[LD::TUI::Event::dy]].
+					 */
+					bool motion = false;
+
+					/**
+					 * Once this many events are waiting, a new motion event
+					 * replaces every older one still in the queue, even if
+					 * something else came in between. 0 never drops any.
+					 */
+					size_t max_pending = 0;
+				};
+
+				void set_coalescing(const Coalesce & policy) {
+					coalesce = policy;
+				}
+
+			private:
+				struct Timer {
+					size_t          id;
+					clock::duration interval;
+					clock::time_point deadline;
+					bool            repeat;
+				};
+
+				RawMode raw;
+
+				int              signal_pipe[2] {-1, -1};
+				struct sigaction old_winch {};
+				struct sigaction old_int {};
+				bool             caught_int = false;
+
+				std::vector<Timer>  timers;
+				size_t              last_timer = 0;
+				std::vector<pollfd> watched;
+				std::deque<Event>   pending;
+
+				bool              stdin_open = true;
+				bool              incomplete = false;
+				clock::time_point escape_deadline;
+
+				Coalesce coalesce;
+				size_t   mouse_x = 0;
+				size_t   mouse_y = 0;
+
+				static int & signal_fd() {
+					static int fd = -1;
+
+					return fd;
+				}
+
+				static void on_signal(int sig) {
+					int saved = errno;
+					auto byte = static_cast<unsigned char>(sig);
+
+					if (signal_fd() >= 0) {
+						(void) !write(signal_fd(), & byte, 1);
+					}
+
+					errno = saved;
+				}
+
+				static int until(clock::time_point now, clock::time_point then) {
+					if (then <= now) {
+						return 0;
+					}
+
+					// round up so we don't wake up just before it's time
+					auto ms = std::chrono::duration_cast<
+						std::chrono::milliseconds
+					>(then - now + std::chrono::microseconds(999)).count();
+
+					return static_cast<int>(ms);
+				}
+
+				static int min_wait(int a, int b) {
+					return a < 0 ? b : (b < a ? b : a);
+				}
+
+				static bool is_motion(const Event & event) {
+					return event.type == Event::MOUSE && event.mouse.motion;
+				}
+
+				/**
+				 * Queues an input event, merging it into what's already
+				 * queued according to [[coalesce]].
+				 */
+				void push(Event event) {
+					if (!pending.empty()) {
+						Event & last = pending.back();
+
+						if (coalesce.repeats && event.type == Event::KEY &&
+						    last.type == Event::KEY && last.key == event.key) {
+							last.count += event.count;
+
+							return;
+						}
+
+						if (coalesce.motion && is_motion(event) &&
+						    is_motion(last) &&
+						    last.mouse.button == event.mouse.button &&
+						    last.mouse.mods == event.mouse.mods) {
+							last.mouse  = event.mouse;
+							last.dx    += event.dx;
+							last.dy    += event.dy;
+							last.count += event.count;
+
+							return;
+						}
+					}
+
+					if (coalesce.max_pending > 0 && is_motion(event) &&
+					    pending.size() >= coalesce.max_pending) {
+						for (auto it = pending.begin(); it != pending.end();) {
+							if (is_motion(* it)) {
+								event.dx    += it->dx;
+								event.dy    += it->dy;
+								event.count += it->count;
+
+								it = pending.erase(it);
+							} else {
+								++it;
+							}
+						}
+					}
+
+					pending.push_back(std::move(event));
+				}
+
+				/**
+				 * Turns whatever is in the stdin buffer into key events.
+				 */
+				void decode_input(bool final) {
+					InputReader & in      = InputReader::stdin_reader();
+					KeyDecoder  & decoder = KeyDecoder::shared();
+
+					Event event;
+
+					while (decoder.next(in, event.key, final)) {
+						if (event.key == Keys::PASTE) {
+							event.type = Event::PASTE;
+							event.text = decoder.take_paste();
+						} else if (event.key == Keys::MOUSE) {
+							event.type  = Event::MOUSE;
+							event.mouse = decoder.mouse();
+							event.dx    = long(event.mouse.x) - long(mouse_x);
+							event.dy    = long(event.mouse.y) - long(mouse_y);
+
+							mouse_x = event.mouse.x;
+							mouse_y = event.mouse.y;
+						}
+
+						push(std::move(event));
+						event = Event();
+					}
+
+					// pastes don't time out, they end when the terminal says
+					if (in.empty() || decoder.in_paste()) {
+						incomplete = false;
+					} else if (!incomplete) {
+						incomplete      = true;
+						escape_deadline = clock::now() +
+						                  std::chrono::milliseconds(
+							                  decoder.escape_timeout_ms
+						                  );
+					}
+				}
+
+				void wait_once(int wait) {
+					std::vector<pollfd> fds;
+
+					fds.push_back({signal_pipe[0], POLLIN, 0});
+
+					if (stdin_open) {
+						fds.push_back({0, POLLIN, 0});
+					}
+
+					fds.insert(fds.end(), watched.begin(), watched.end());
+
+					if (::poll(fds.data(), fds.size(), wait) <= 0) {
+						return;
+					}
+
+					if (fds[0].revents & POLLIN) {
+						read_signals();
+					}
+
+					size_t first_watched = 1;
+
+					if (stdin_open) {
+						first_watched = 2;
+
+						if (fds[1].revents & (POLLIN | POLLHUP | POLLERR)) {
+							read_input();
+						}
+					}
+
+					for (size_t i = first_watched; i < fds.size(); i++) {
+						if (fds[i].revents != 0) {
+							Event event;
+							event.type    = Event::FD_READY;
+							event.fd      = fds[i].fd;
+							event.revents = fds[i].revents;
+
+							pending.push_back(event);
+						}
+					}
+				}
+
+				void read_signals() {
+					unsigned char sigs[64];
+					ssize_t       got;
+
+					while ((got = read(signal_pipe[0], sigs, sizeof(sigs))) > 0) {
+						for (ssize_t i = 0; i < got; i++) {
+							Event event;
+
+							if (sigs[i] == SIGWINCH) {
+								auto size = terminal_size();
+
+								event.type   = Event::RESIZE;
+								event.width  = size.first;
+								event.height = size.second;
+							} else {
+								event.type   = Event::SIGNAL;
+								event.signal = sigs[i];
+							}
+
+							pending.push_back(event);
+						}
+					}
+				}
+
+				void read_input() {
+					InputReader & in = InputReader::stdin_reader();
+
+					if (!in.fill(0) && in.eof()) {
+						// whatever was left over isn't going to be finished
+						decode_input(true);
+
+						stdin_open = false;
+
+						Event event;
+						event.type = Event::CLOSED;
+
+						pending.push_back(event);
+					}
+				}
+
+				void fire_timers(clock::time_point now) {
+					std::vector<size_t> finished;
+
+					for (Timer & timer : timers) {
+						if (timer.deadline > now) {
+							continue;
+						}
+
+						Event event;
+						event.type  = Event::TICK;
+						event.timer = timer.id;
+
+						pending.push_back(event);
+
+						if (timer.repeat) {
+							timer.deadline += timer.interval;
+
+							// don't try to catch up on ticks that were missed
+							if (timer.deadline <= now) {
+								timer.deadline = now + timer.interval;
+							}
+						} else {
+							finished.push_back(timer.id);
+						}
+					}
+
+					for (size_t id : finished) {
+						remove_timer(id);
+					}
+				}
+
+				// @formatter:off
+			#ifdef LD_USE_COROUTINES
+				struct Waiter {
+					enum Kind {
+						ANY, KEY, TIMER
+					};
+
+					std::coroutine_handle<> handle;
+					Kind                    kind;
+					size_t                  timer;
+					Event                   * slot;
+				};
+
+				template <class Result>
+					struct Awaiter {
+						EventLoop    & loop;
+						Waiter::Kind kind;
+						size_t       timer = 0;
+						Event        event;
+
+						Awaiter(EventLoop & loop, Waiter::Kind kind,
+						        size_t timer = 0)
+							: loop(loop), kind(kind), timer(timer) {}
+
+						bool await_ready() const noexcept {
+							return false;
+						}
+
+						void await_suspend(std::coroutine_handle<> handle) {
+							loop.waiters.push_back({handle, kind, timer,
+							                        & event});
+						}
+
+						Result await_resume() const noexcept {
+							if constexpr (std::is_same<Result, Event>::value) {
+								return event;
+							} else if constexpr (std::is_same<
+								Result, Keys::Key
+							>::value) {
+								return event.key;
+							}
+						}
+					};
+
+				std::vector<Waiter> waiters;
+				bool                running = false;
+
+				static bool wants(const Waiter & waiter, const Event & event) {
+					switch (waiter.kind) {
+						case Waiter::ANY:
+							return true;
+						case Waiter::KEY:
+							return event.type == Event::KEY;
+						case Waiter::TIMER:
+							return event.type == Event::TICK &&
+							       event.timer == waiter.timer;
+					}
+
+					return false;
+				}
+
+				/**
+				 * Hands `event` to every coroutine waiting for it. They're
+				 * taken off the list first, since resuming them will probably
+				 * add new waiters.
+				 */
+				void dispatch(const Event & event) {
+					std::vector<Waiter> ready;
+
+					for (auto it = waiters.begin(); it != waiters.end();) {
+						if (wants(* it, event)) {
+							ready.push_back(* it);
+							it = waiters.erase(it);
+						} else {
+							++it;
+						}
+					}
+
+					for (Waiter & waiter : ready) {
+						* waiter.slot = event;
+						waiter.handle.resume();
+					}
+				}
+			#endif
+				// @formatter:on
+		};
+	}
+}
+
+#endif //__LD_EVENT_HPP
@@ -0,0 +1,257 @@
+#ifndef __LD_FRAME_HPP
+#define __LD_FRAME_HPP
+
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <string_view>
+
+#include "ld_arena.hpp"
+#include "ld_output.hpp"
+#include "ld_trace.hpp"
+#include "ld_wstr.hpp"
+
+namespace LD {
+	/**
+	 * Collects everything an app wants to put on the screen and sends it to
+	 * the terminal as whole frames: at most once per frame interval while
+	 * updates keep coming, or straight away once the app says it's idle.
+	 * Each frame is one write() wrapped in synchronized update markers (DEC
+	 * mode 2026), so terminals that support them show it all at once, and
+	 * terminals that don't just ignore them.
+	 *
+	 * Strings for a frame can be built in [[arena]], which is reset after
+	 * each frame is sent. Together with the reused output buffers, that
+	 * means steady-state rendering doesn't touch the heap.
+	 *
+	 *     LD::FrameScheduler frames(60);
+	 *
+	 *     while (loop.poll(event, frames.wait_ms())) {
+	 *         handle(event);          // calls frames.write(...)
+	 *
+	 *         if (loop.has_pending()) {
+	 *             frames.tick();      // more to do, only flush if it's time
+	 *         } else {
+	 *             frames.idle();      // caught up, show it now
+	 *         }
+	 *     }
+	 */
+	class FrameScheduler {
+		public:
+			using clock = std::chrono::steady_clock;
+
+			/**
+			 * @param hz The most frames to send per second while busy.
+			 * @param sync Whether to wrap frames in synchronized update
+			 * markers. Only ever done if stdout is a terminal.
+			 */
+			explicit FrameScheduler(double hz = 60, bool sync = true)
+				: interval(std::chrono::duration_cast<clock::duration>(
+					std::chrono::duration<double>(1 / (hz > 0 ? hz : 60))
+				)), sync(sync && isatty(1) != 0) {}
+
+			/**
+			 * Sends whatever hasn't been sent yet.
+			 */
+			~FrameScheduler() {
+				flush();
+			}
+
+			FrameScheduler(const FrameScheduler &) = delete;
+			FrameScheduler & operator=(const FrameScheduler &) = delete;
+
+			/**
+			 * Adds to the next frame. Use this instead of [[LD::o]].
+			 *
+			 * @param text
+			 */
+			void write(std::wstring_view text) {
+				pending.append(text);
+				writes++;
+			}
+
+			/**
+			 * Replaces the next frame with `text`, for apps that redraw the
+			 * whole screen every time. Anything written since the last
+			 * frame went out is thrown away, since it would be drawn over
+			 * anyway.
+			 *
+			 * @param text
+			 */
+			void set(std::wstring_view text) {
+				pending.assign(text);
+				writes++;
+			}
+
+			/**
+			 * @return An arena for building this frame's strings, for the
+			 * [[std::pmr]] overloads in [[LD::ANSI]], [[LD::SGR]] and
+			 * ld_sutil. Everything in it is freed when the frame is sent.
+			 */
+			FrameArena & arena() {
+				return frame_arena;
+			}
+
+			/**
+			 * @return Whether there's anything waiting to be sent.
+			 */
+			bool dirty() const {
+				return !pending.empty();
+			}
+
+			/**
+			 * @return How long until the next frame is due, for use as a
+			 * poll timeout, or -1 if nothing is waiting to be sent.
+			 */
+			int wait_ms() const {
+				if (pending.empty()) {
+					return -1;
+				}
+
+				auto left = last_flush + interval - clock::now();
+
+				if (left <= clock::duration::zero()) {
+					return 0;
+				}
+
+				// rounded up, so the frame is actually due when poll returns
+				return static_cast<int>(std::chrono::duration_cast<
+					std::chrono::milliseconds
+				>(left + std::chrono::milliseconds(1) -
+				  clock::duration(1)).count());
+			}
+
+			/**
+			 * Sends the next frame if it's due.
+			 *
+			 * @return Whether a frame was sent
+			 */
+			bool tick() {
+				if (pending.empty() || clock::now() - last_flush < interval) {
+					return false;
+				}
+
+				return flush();
+			}
+
+			/**
+			 * Tells the scheduler the app has nothing more to draw for now,
+			 * so the frame is sent without waiting for the interval.
+			 *
+			 * @return Whether a frame was sent
+			 */
+			bool idle() {
+				return flush();
+			}
+
+			/**
+			 * Sends the next frame right now, in a single write.
+			 *
+			 * @return Whether there was anything to send
+			 */
+			bool flush() {
+				if (pending.empty()) {
+					return false;
+				}
+
+				LD_TRACE_SCOPE("LD::FrameScheduler::flush");
+				LD_STAT(FLUSHES, 1);
+
+				if (output_sink()) {
+					// the sink gets the same frame the terminal would
+					if (sync) {
+						framed.assign(WSYNC_ON);
+						framed.append(pending);
+						framed.append(WSYNC_OFF);
+						output_sink()(framed);
+					} else {
+						output_sink()(pending);
+					}
+
+					finish();
+
+					return true;
+				}
+
+				bytes.clear();
+
+				if (sync) {
+					bytes.append(SYNC_ON);
+				}
+
+				w2str(pending, bytes);
+
+				if (sync) {
+					bytes.append(SYNC_OFF);
+				}
+
+				// anything written with LD::o has to come first
+				std::fflush(stdout);
+				write_all(bytes);
+				finish();
+
+				return true;
+			}
+
+			/**
+			 * @return How many frames have been sent.
+			 */
+			size_t frame_count() const {
+				return frames;
+			}
+
+			/**
+			 * @return How many writes went into those frames, including
+			 * ones that were replaced by [[set]].
+			 */
+			size_t write_count() const {
+				return writes;
+			}
+
+		private:
+			clock::duration   interval;
+			bool              sync;
+			clock::time_point last_flush;
+			std::wstring      pending;
+			std::wstring      framed;
+			std::string       bytes;
+			FrameArena        frame_arena;
+			size_t            frames = 0;
+			size_t            writes = 0;
+
+			static constexpr char SYNC_ON[]  = "\033[?2026h";
+			static constexpr char SYNC_OFF[] = "\033[?2026l";
+
+			static constexpr wchar_t WSYNC_ON[]  = L"\033[?2026h";
+			static constexpr wchar_t WSYNC_OFF[] = L"\033[?2026l";
+
+			void finish() {
+				pending.clear();
+				frame_arena.reset();
+				last_flush = clock::now();
+				frames++;
+			}
+
+			static void write_all(const std::string & bytes) {
+				size_t done = 0;
+
+				while (done < bytes.size()) {
+					ssize_t wrote = ::write(1, bytes.data() + done,
+					                        bytes.size() - done);
+
+					if (wrote < 0 && errno == EINTR) {
+						continue;
+					} else if (wrote <= 0) {
+						return;
+					}
+
+					done += static_cast<size_t>(wrote);
+				}
+			}
+	};
+}
+
+#endif //__LD_FRAME_HPP
@@ -1,21 +1,217 @@
 #ifndef __LD_INPUT_HPP
 #define __LD_INPUT_HPP
 
-#include <iostream>
+#include <unistd.h>
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <functional>
 #include <string>
+#include <string_view>
 #include <sstream>
+#include <type_traits>
+#include <vector>
 
-#include "ld_termcolor.hpp"
-#include "ld_linenoise.hpp"
+#include "ld_config.hpp"
+#include "ld_complete.hpp"
+#include "ld_mmap.hpp"
+#include "ld_num.hpp"
 #include "ld_output.hpp"
 #include "ld_sutil.hpp"
 
 #define USER_WANTS_QUIT std::runtime_error("User requested to quit")
 
 namespace LD {
+	/**
+	 * Reads stdin line by line when it isn't a terminal, for batch jobs that
+	 * pipe answers into prompts. Regular files are mapped with [[mmap]],
+	 * pipes are read in large chunks, and lines are split with
+	 * [[std::memchr]] (which the C library vectorizes) instead of going
+	 * through [[std::wcin]].
+	 *
+	 * Once this has started reading, anything else that reads stdin will
+	 * miss whatever it has buffered.
+	 */
+	class BulkInput {
+		public:
+			/**
+			 * @return Whether stdin isn't a terminal, in which case
+			 * [[LD::get_input]] and friends read from
+			 * [[LD::BulkInput::stdin_input]] and don't show prompts.
+			 */
+			static bool active() {
+				static bool active = isatty(0) == 0;
+
+				return active;
+			}
+
+			static BulkInput & stdin_input() {
+				static BulkInput input(0);
+
+				return input;
+			}
+
+			explicit BulkInput(int fd)
+				: fd(fd), file(fd, lseek(fd, 0, SEEK_CUR)) {
+				if (file.valid()) {
+					begin = file.data();
+					end   = begin + file.size();
+				}
+			}
+
+			BulkInput(const BulkInput &) = delete;
+			BulkInput & operator=(const BulkInput &) = delete;
+
+			/**
+			 * Gets the next line, without its line ending. The view is only
+			 * good until the next call.
+			 *
+			 * @param line
+			 * @return false at EOF
+			 */
+			bool next_line(std::string_view & line) {
+				while (true) {
+					// memchr can't be given a null pointer, even to search
+					// nothing, and nothing's been read yet
+					auto * nl = begin == end ? nullptr : static_cast<const char *>(
+						std::memchr(begin, '\n', end - begin)
+					);
+
+					if (nl != nullptr) {
+						line  = trim_cr(begin, nl);
+						begin = nl + 1;
+
+						return true;
+					}
+
+					if (file.valid() || !refill()) {
+						break;
+					}
+				}
+
+				if (begin == end) {
+					return false;
+				}
+
+				// last line without a trailing newline
+				line  = trim_cr(begin, end);
+				begin = end;
+
+				return true;
+			}
+
+		private:
+			static constexpr size_t CHUNK = 1 << 20;
+
+			int               fd;
+			MappedFile        file;
+			std::vector<char> buf;
+			const char        * begin = nullptr;
+			const char        * end   = nullptr;
+			bool              eof     = false;
+
+			static std::string_view trim_cr(const char * from, const char * to) {
+				if (to > from && to[-1] == '\r') {
+					to--;
+				}
+
+				return std::string_view(from, to - from);
+			}
+
+			/**
+			 * Moves the unfinished line to the front of the buffer and reads
+			 * another chunk after it.
+			 */
+			bool refill() {
+				if (eof) {
+					return false;
+				}
+
+				size_t kept = end - begin;
+
+				if (kept > 0 && begin != buf.data()) {
+					std::memmove(buf.data(), begin, kept);
+				}
+
+				if (buf.size() < kept + CHUNK) {
+					buf.resize(kept + CHUNK);
+				}
+
+				ssize_t got;
+
+				do {
+					got = read(fd, buf.data() + kept, buf.size() - kept);
+				} while (got < 0 && errno == EINTR);
+
+				if (got <= 0) {
+					eof = true;
+					got = 0;
+				}
+
+				begin = buf.data();
+				end   = begin + kept + got;
+
+				return got > 0;
+			}
+	};
+
+	/**
+	 * Completes a line of input. Gets the line so far and adds whole
+	 * replacement lines to the vector.
+	 */
+	using Completer = std::function<
+		void(const std::string &, std::vector<std::string> &)
+	>;
+
+	/**
+	 * What [[LD::get_input]] uses for tab completion and history. Set with
+	 * [[LD::set_completer]] and [[LD::set_history]].
+	 */
+	struct InputHooks {
+		Completer completer;
+		History   * history = nullptr;
+	};
+
+	inline InputHooks & input_hooks() {
+		static InputHooks hooks;
+
+		return hooks;
+	}
+
+	/**
+	 * Sets the tab completion callback for [[LD::get_input]]. Only has an
+	 * effect with linenoise, since plain [[std::getline]] can't complete
+	 * anything.
+	 *
+	 * @param completer
+	 */
+	LD_DECL void set_completer(Completer completer);
+
+	/**
+	 * Makes [[LD::get_input]] complete the last word of the line from
+	 * `index`. The index isn't copied, so it can keep being updated, but it
+	 * has to outlive the completer.
+	 *
+	 * @param index
+	 * @param limit The most candidates to offer at once.
+	 */
+	LD_DECL void set_completer(const CompletionIndex & index, size_t limit = 64);
+
+	/**
+	 * Makes [[LD::get_input]] add every line to `history`, and with linenoise,
+	 * makes the last `recall` entries available with the arrow keys. Pass
+	 * nullptr to stop recording.
+	 *
+	 * @param history Not copied, so it has to outlive its use.
+	 * @param recall
+	 */
+	LD_DECL void set_history(History * history, size_t recall = 1000);
+
 	/**
 	 * Gets input. Uses [[linenoise::Readline]] if needed, else uses
-	 * [[std::getline]].
+	 * [[std::getline]]. If stdin isn't a terminal, reads the next line from
+	 * [[LD::BulkInput]] without showing the prompt.
 	 *
 	 * Returns true if the program should quit.
 	 *
@@ -23,40 +219,11 @@ namespace LD {
 	 * @param output
 	 * @return
 	 */
-	bool get_input(const std::wstring & prompt, std::wstring & output) {
-		// @formatter:off
-	#ifdef LD_USE_LINENOISE
-		std::string dummy_output = w2str(output);
-
-		bool success =
-			linenoise::Readline(LD::w2str(prompt).c_str(), dummy_output);
-
-		output = s2wstr(dummy_output);
-
-		return success;
-	#else
-		o(prompt);
-		std::getline(std::wcin, output);
-
-		return !std::wcin;
-	#endif
-		// @formatter:on
-	}
+	LD_DECL bool get_input(const std::wstring & prompt, std::wstring & output);
 
 	// @formatter:off
-	bool get_input(const std::wstring & prompt, std::wstring & output,
-				   bool log_color) {
-	#ifdef LD_USE_TERMCOLOR
-		if (log_color) {
-			return get_input(LOG_STYLE + prompt + GET_ANSI(termcolor::reset),
-							 output);
-		} else {
-	#endif
-			return get_input(prompt, output);
-	#ifdef LD_USE_TERMCOLOR
-		}
-	#endif
-	}
+	LD_DECL bool get_input(const std::wstring & prompt, std::wstring & output,
+				   bool log_color);
 	// @formatter:on
 
 	/**
@@ -66,15 +233,73 @@ namespace LD {
 	 * @param prompt
 	 * @return
 	 */
-	std::wstring get_input(std::wstring & prompt, bool log_color = false) {
-		std::wstring output;
+	LD_DECL std::wstring get_input(std::wstring & prompt, bool log_color = false);
 
-		if (get_input(prompt, output, log_color)) {
-			throw USER_WANTS_QUIT;
-		}
+	/**
+	 * Whether [[std::from_chars]] can parse a `Num`: integers and floating
+	 * point numbers, but not bool or the character types, which it has no
+	 * overloads for.
+	 *
+	 * @tparam Num
+	 */
+	template <class Num>
+		constexpr bool is_chars_num =
+			std::is_floating_point<Num>::value || (
+				std::is_integral<Num>::value &&
+				!std::is_same<Num, bool>::value &&
+				!std::is_same<Num, char>::value &&
+				!std::is_same<Num, signed char>::value &&
+				!std::is_same<Num, unsigned char>::value &&
+				!std::is_same<Num, wchar_t>::value &&
+				!std::is_same<Num, char16_t>::value &&
+				!std::is_same<Num, char32_t>::value
+			);
 
-		return output;
-	}
+	/**
+	 * [[LD::get_num_input]] for plain numbers when stdin isn't a terminal.
+	 * Parses straight out of [[LD::BulkInput]]'s buffer with
+	 * [[std::from_chars]], without converting to a wide string first.
+	 *
+	 * @tparam Num A type [[LD::is_chars_num]] holds for.
+	 * @param output
+	 * @return true at EOF
+	 */
+	template <class Num>
+		bool get_bulk_num(Num & output) {
+			std::string_view line;
+
+			while (BulkInput::stdin_input().next_line(line)) {
+				size_t first = line.find_first_not_of(" \t");
+				size_t last  = line.find_last_not_of(" \t");
+
+				if (first != std::string_view::npos) {
+					const char * from = line.data() + first;
+					const char * to   = line.data() + last + 1;
+
+					bool valid = true;
+
+					if (* from == '+') {
+						from++;
+
+						// from_chars takes a '-' of its own, so "+-5" would
+						// come out as -5
+						valid = from == to || * from != '-';
+					}
+
+					if (valid) {
+						auto result = std::from_chars(from, to, output);
+
+						if (result.ec == std::errc() && result.ptr == to) {
+							return false;
+						}
+					}
+				}
+
+				errnl(L"You must enter a number!");
+			}
+
+			return true;
+		}
 
 	/**
 	 * This function uses [[LD::get_input]] in a loop to get an object from the
@@ -95,6 +320,12 @@ namespace LD {
 		bool get_num_input(
 			const std::wstring & prompt, Num & output, bool log_color = false
 		) {
+			if constexpr (is_chars_num<Num>) {
+				if (BulkInput::active()) {
+					return get_bulk_num(output);
+				}
+			}
+
 			std::wstring input;
 
 			while (true) {
@@ -124,6 +355,37 @@ namespace LD {
 			}
 		}
 
+	/**
+	 * Calls [[LD::get_num_input]] up to `count` times, appending the numbers
+	 * to `output`. When stdin isn't a terminal this is a tight loop over
+	 * [[LD::get_bulk_num]].
+	 *
+	 * @tparam Num
+	 * @param prompt
+	 * @param output
+	 * @param count
+	 * @param log_color
+	 * @return true if the input ran out first
+	 */
+	template <class Num>
+		bool get_num_inputs(const std::wstring & prompt,
+		                    std::vector<Num> & output, size_t count,
+		                    bool log_color = false) {
+			output.reserve(output.size() + count);
+
+			Num num;
+
+			for (size_t i = 0; i < count; i++) {
+				if (get_num_input(prompt, num, log_color)) {
+					return true;
+				}
+
+				output.push_back(num);
+			}
+
+			return false;
+		}
+
 	/**
 	 * Gets a yes/no input from the user. You are advised to follow the normal
 	 * CLI tradition, i.e. "Do this thing? [y/N]", including the capital "N".
@@ -134,7 +396,152 @@ namespace LD {
 	 * @param log_color Whether to color it. Defaults to false.
 	 * @return
 	 */
-	bool get_yn(const std::wstring & prompt, bool log_color = false) {
+	LD_DECL bool get_yn(const std::wstring & prompt, bool log_color = false);
+
+	/**
+	 * Creates an option menu with the options `options`. Sets `selected` to the
+	 * *index* of which item was selected.
+	 *
+	 * @param options
+	 * @param selected
+	 */
+	LD_DECL void option_menu(
+		const std::vector<std::wstring> options, math::Unsigned & selected
+	);
+}
+
+#if LD_DEFINITIONS
+#include <iostream>
+
+#include "ld_linenoise.hpp"
+#include "ld_termcolor.hpp"
+
+namespace LD {
+	LD_DECL void set_completer(Completer completer) {
+		input_hooks().completer = std::move(completer);
+
+		// @formatter:off
+	#ifdef LD_USE_LINENOISE
+		linenoise::SetCompletionCallback(
+			[](const char * buf, std::vector<std::string> & completions) {
+				if (input_hooks().completer) {
+					input_hooks().completer(buf, completions);
+				}
+			}
+		);
+	#endif
+		// @formatter:on
+	}
+
+	LD_DECL void set_completer(const CompletionIndex & index, size_t limit) {
+		set_completer(
+			[& index, limit](const std::string & line,
+			                 std::vector<std::string> & completions) {
+				size_t      word = line.find_last_of(" \t") + 1;
+				std::string head = line.substr(0, word);
+
+				std::vector<std::string> found;
+				index.complete(std::string_view(line).substr(word), found,
+				               limit);
+
+				for (const auto & candidate : found) {
+					completions.push_back(head + candidate);
+				}
+			}
+		);
+	}
+
+	LD_DECL void set_history(History * history, size_t recall) {
+		input_hooks().history = history;
+
+		// @formatter:off
+	#ifdef LD_USE_LINENOISE
+		if (history != nullptr) {
+			linenoise::SetHistoryMaxLen(recall);
+
+			size_t first = history->size() > recall
+			               ? history->size() - recall : 0;
+
+			for (size_t i = first; i < history->size(); i++) {
+				linenoise::AddHistory(std::string((* history)[i]).c_str());
+			}
+		}
+	#else
+		(void) recall;
+	#endif
+		// @formatter:on
+	}
+
+	LD_DECL bool get_input(const std::wstring & prompt, std::wstring & output) {
+		if (BulkInput::active()) {
+			std::string_view line;
+
+			if (!BulkInput::stdin_input().next_line(line)) {
+				return true;
+			}
+
+			output = s2wstr(std::string(line));
+
+			return false;
+		}
+
+		History * history = input_hooks().history;
+
+		// @formatter:off
+	#ifdef LD_USE_LINENOISE
+		std::string dummy_output = w2str(output);
+
+		bool success =
+			linenoise::Readline(LD::w2str(prompt).c_str(), dummy_output);
+
+		output = s2wstr(dummy_output);
+
+		if (!success && history != nullptr) {
+			history->add(dummy_output);
+			linenoise::AddHistory(dummy_output.c_str());
+		}
+
+		return success;
+	#else
+		o(prompt);
+		std::getline(std::wcin, output);
+
+		if (std::wcin && history != nullptr) {
+			history->add(w2str(output));
+		}
+
+		return !std::wcin;
+	#endif
+		// @formatter:on
+	}
+
+	// @formatter:off
+	LD_DECL bool get_input(const std::wstring & prompt, std::wstring & output,
+				   bool log_color) {
+	#ifdef LD_USE_TERMCOLOR
+		if (log_color) {
+			return get_input(LOG_STYLE + prompt + GET_ANSI(termcolor::reset),
+							 output);
+		} else {
+	#endif
+			return get_input(prompt, output);
+	#ifdef LD_USE_TERMCOLOR
+		}
+	#endif
+	}
+	// @formatter:on
+
+	LD_DECL std::wstring get_input(std::wstring & prompt, bool log_color) {
+		std::wstring output;
+
+		if (get_input(prompt, output, log_color)) {
+			throw USER_WANTS_QUIT;
+		}
+
+		return output;
+	}
+
+	LD_DECL bool get_yn(const std::wstring & prompt, bool log_color) {
 		std::wstring input;
 
 		while (true) {
@@ -165,14 +572,7 @@ namespace LD {
 		}
 	}
 
-	/**
-	 * Creates an option menu with the options `options`. Sets `selected` to the
-	 * *index* of which item was selected.
-	 *
-	 * @param options
-	 * @param selected
-	 */
-	void option_menu(
+	LD_DECL void option_menu(
 		const std::vector<std::wstring> options, math::Unsigned & selected
 	) {
 		/**
@@ -267,5 +667,6 @@ namespace LD {
 		}
 	}
 }
+#endif
 
 #endif //__LD_INPUT_HPP
@@ -0,0 +1,534 @@
+#ifndef __LD_LAYOUT_HPP
+#define __LD_LAYOUT_HPP
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "ld_config.hpp"
+#include "ld_sutil.hpp"
+#include "ld_trace.hpp"
+
+namespace LD {
+	/**
+	 * A small retained layout tree: labels, horizontal and vertical stacks,
+	 * and bordered boxes. Every node caches its natural size and the lines
+	 * it last drew at each size, and changing a node only throws away its
+	 * own cache and its ancestors', so redrawing after one label changes
+	 * re-renders that label and the stacks it's in, and reuses every other
+	 * node's lines as they are.
+	 *
+	 *     auto root = std::make_unique<LD::Layout::Stack>(
+	 *         LD::Layout::Stack::VERTICAL);
+	 *
+	 *     auto & status = root->emplace<LD::Layout::Label>(L"ready");
+	 *     root->emplace<LD::Layout::Box>(
+	 *         std::make_unique<LD::Layout::Label>(L"body"), L"Log").flex();
+	 *
+	 *     auto size = LD::TUI::terminal_size();
+	 *     LD::ofl(LD::join_str(root->render(size.first, size.second), L'\n'));
+	 *
+	 *     status.set_text(L"working");
+	 */
+	namespace Layout {
+		class Node {
+			public:
+				virtual ~Node() = default;
+
+				Node() = default;
+				Node(const Node &) = delete;
+				Node & operator=(const Node &) = delete;
+
+				/**
+				 * @return The width and height this node wants, like
+				 * [[LD::get_dimensions]]. Cached until [[invalidate]].
+				 */
+				const std::pair<size_t, size_t> & measure();
+
+				/**
+				 * Draws the node into exactly `height` lines of exactly
+				 * `width` characters each. Cached until [[invalidate]], or
+				 * until it's drawn at a different size.
+				 *
+				 * @param width
+				 * @param height
+				 * @return
+				 */
+				const std::vector<std::wstring> & render(size_t width,
+				                                         size_t height) {
+					if (!drawn || width != drawn_width ||
+					    height != drawn_height) {
+						LD_TRACE_SCOPE("LD::Layout::Node::render");
+
+						lines.assign(height, std::wstring());
+
+						for (auto & line : lines) {
+							line.reserve(width);
+						}
+
+						draw(width, height, lines);
+
+						drawn        = true;
+						drawn_width  = width;
+						drawn_height = height;
+					}
+
+					return lines;
+				}
+
+				/**
+				 * Throws away this node's cached size and lines, and its
+				 * ancestors', since their layout might depend on them. Call
+				 * it after changing whatever the node draws.
+				 */
+				void invalidate();
+
+				/**
+				 * Makes the node take exactly `size` cells along its parent
+				 * stack's direction.
+				 *
+				 * @param size
+				 * @return this
+				 */
+				Node & fixed(size_t size) {
+					fixed_size = size;
+					flex_grow  = 0;
+					invalidate();
+
+					return * this;
+				}
+
+				/**
+				 * Makes the node share whatever space its parent stack has
+				 * left over with the other flexible nodes, in proportion to
+				 * `weight`.
+				 *
+				 * @param weight
+				 * @return this
+				 */
+				Node & flex(size_t weight = 1) {
+					fixed_size = 0;
+					flex_grow  = weight;
+					invalidate();
+
+					return * this;
+				}
+
+				size_t get_fixed() const {
+					return fixed_size;
+				}
+
+				size_t get_flex() const {
+					return flex_grow;
+				}
+
+			protected:
+				/**
+				 * @return The natural width and height of the node.
+				 */
+				virtual std::pair<size_t, size_t> compute_size() = 0;
+
+				/**
+				 * @param width
+				 * @param height
+				 * @param out `height` empty lines, to be filled with
+				 * exactly `width` characters each.
+				 */
+				virtual void draw(size_t width, size_t height,
+				                  std::vector<std::wstring> & out) = 0;
+
+				/**
+				 * Makes `child`'s changes invalidate this node too.
+				 */
+				void adopt(Node & child);
+
+			private:
+				Node * parent = nullptr;
+
+				size_t fixed_size = 0;
+				size_t flex_grow  = 0;
+
+				bool                      measured = false;
+				std::pair<size_t, size_t> natural;
+
+				bool                      drawn        = false;
+				size_t                    drawn_width  = 0;
+				size_t                    drawn_height = 0;
+				std::vector<std::wstring> lines;
+		};
+
+		/**
+		 * Text, which can have more than one line. Lines that don't fit are
+		 * cut off.
+		 */
+		class Label : public Node {
+			public:
+				explicit Label(std::wstring text = L"")
+					: text(std::move(text)) {}
+
+				const std::wstring & get_text() const {
+					return text;
+				}
+
+				void set_text(std::wstring new_text) {
+					if (new_text != text) {
+						text = std::move(new_text);
+						invalidate();
+					}
+				}
+
+			protected:
+				std::pair<size_t, size_t> compute_size() override;
+
+				void draw(size_t width, size_t height,
+				          std::vector<std::wstring> & out) override;
+
+			private:
+				std::wstring text;
+		};
+
+		/**
+		 * Lays its children out one after another, either left to right or
+		 * top to bottom. Along that direction, each child gets its
+		 * [[Node::fixed]] size if it has one, the space left over if it's
+		 * [[Node::flex]], and its natural size otherwise. Across it, every
+		 * child gets the whole stack.
+		 */
+		class Stack : public Node {
+			public:
+				enum Direction {
+					HORIZONTAL,
+					VERTICAL
+				};
+
+				explicit Stack(Direction direction, size_t gap = 0)
+					: direction(direction), gap(gap) {}
+
+				/**
+				 * @param child
+				 * @return The child
+				 */
+				template <class T>
+					T & add(std::unique_ptr<T> child) {
+						T & ref = * child;
+
+						adopt(ref);
+						children.push_back(std::move(child));
+						invalidate();
+
+						return ref;
+					}
+
+				template <class T, class... Args>
+					T & emplace(Args && ... args) {
+						return add(std::make_unique<T>(
+							std::forward<Args>(args)...
+						));
+					}
+
+				size_t size() const {
+					return children.size();
+				}
+
+				Node & operator[](size_t i) {
+					return * children[i];
+				}
+
+			protected:
+				std::pair<size_t, size_t> compute_size() override;
+
+				void draw(size_t width, size_t height,
+				          std::vector<std::wstring> & out) override;
+
+			private:
+				Direction direction;
+				size_t    gap;
+
+				std::vector<std::unique_ptr<Node>> children;
+
+				/**
+				 * Swaps width and height for horizontal stacks, so the first
+				 * one is always along the stack.
+				 */
+				std::pair<size_t, size_t> oriented(
+					std::pair<size_t, size_t> size) const {
+					if (direction == HORIZONTAL) {
+						return size;
+					}
+
+					return std::make_pair(size.second, size.first);
+				}
+
+				/**
+				 * Shares `space` out between the children. If there isn't
+				 * enough, the last children get squeezed first.
+				 */
+				std::vector<size_t> allocate(size_t space) const;
+
+				/**
+				 * Leaves `count` cells blank along the stack, starting at
+				 * `pos`.
+				 */
+				void blank(std::vector<std::wstring> & out, size_t width,
+				           size_t pos, size_t count) const;
+		};
+
+		/**
+		 * Draws a border around one child, with an optional title in the
+		 * top edge, in the same style as [[LD::render_tabulated]].
+		 */
+		class Box : public Node {
+			public:
+				explicit Box(std::unique_ptr<Node> content,
+				             std::wstring title = L"")
+					: content(std::move(content)), title(std::move(title)) {
+					adopt(* this->content);
+				}
+
+				Node & get_content() {
+					return * content;
+				}
+
+				void set_title(std::wstring new_title) {
+					if (new_title != title) {
+						title = std::move(new_title);
+						invalidate();
+					}
+				}
+
+			protected:
+				std::pair<size_t, size_t> compute_size() override;
+
+				void draw(size_t width, size_t height,
+				          std::vector<std::wstring> & out) override;
+
+			private:
+				std::unique_ptr<Node> content;
+				std::wstring          title;
+		};
+	}
+}
+
+#if LD_DEFINITIONS
+namespace LD {
+	namespace Layout {
+		LD_DECL const std::pair<size_t, size_t> & Node::measure() {
+			if (!measured) {
+				natural  = compute_size();
+				measured = true;
+			}
+
+			return natural;
+		}
+
+		LD_DECL void Node::invalidate() {
+			for (Node * node = this; node != nullptr;
+			     node = node->parent) {
+				node->measured = false;
+				node->drawn    = false;
+			}
+		}
+
+		LD_DECL void Node::adopt(Node & child) {
+			child.parent = this;
+		}
+
+		LD_DECL std::pair<size_t, size_t> Label::compute_size() {
+			return get_dimensions(text);
+		}
+
+		LD_DECL void Label::draw(size_t width, size_t height,
+		                         std::vector<std::wstring> & out) {
+			size_t last = 0;
+			bool   more = true;
+
+			for (size_t row = 0; row < height; row++) {
+				if (more) {
+					size_t end = text.find(L'\n', last);
+
+					if (end == std::wstring::npos) {
+						end  = text.size();
+						more = false;
+					}
+
+					out[row].append(text, last,
+					                std::min(end - last, width));
+					last = end + 1;
+				}
+
+				out[row].resize(width, L' ');
+			}
+		}
+
+		LD_DECL std::pair<size_t, size_t> Stack::compute_size() {
+			size_t along  = 0;
+			size_t across = 0;
+
+			for (size_t i = 0; i < children.size(); i++) {
+				auto size = oriented(children[i]->measure());
+
+				along += children[i]->get_fixed() > 0
+				         ? children[i]->get_fixed() : size.first;
+				across = std::max(across, size.second);
+
+				if (i > 0) {
+					along += gap;
+				}
+			}
+
+			return oriented(std::make_pair(along, across));
+		}
+
+		LD_DECL void Stack::draw(size_t width, size_t height,
+		                         std::vector<std::wstring> & out) {
+			bool   horizontal = direction == HORIZONTAL;
+			size_t space      = horizontal ? width : height;
+			size_t across     = horizontal ? height : width;
+
+			std::vector<size_t> sizes = allocate(space);
+			size_t              pos   = 0;
+
+			for (size_t i = 0; i < children.size() && pos < space;
+			     i++) {
+				if (i > 0) {
+					blank(out, width, pos, std::min(gap, space - pos));
+					pos = std::min(pos + gap, space);
+				}
+
+				if (sizes[i] == 0) {
+					continue;
+				}
+
+				const auto & lines = horizontal
+				                     ? children[i]->render(sizes[i], across)
+				                     : children[i]->render(across, sizes[i]);
+
+				if (horizontal) {
+					for (size_t row = 0; row < height; row++) {
+						out[row].append(lines[row]);
+					}
+				} else {
+					for (size_t row = 0; row < sizes[i]; row++) {
+						out[pos + row] = lines[row];
+					}
+				}
+
+				pos += sizes[i];
+			}
+
+			blank(out, width, pos, space - pos);
+		}
+
+		LD_DECL std::vector<size_t> Stack::allocate(size_t space) const {
+			std::vector<size_t> sizes(children.size(), 0);
+
+			size_t used    = children.empty()
+			                 ? 0 : gap * (children.size() - 1);
+			size_t weights = 0;
+
+			for (size_t i = 0; i < children.size(); i++) {
+				Node & child = * children[i];
+
+				if (child.get_flex() > 0) {
+					weights += child.get_flex();
+				} else if (child.get_fixed() > 0) {
+					sizes[i] = child.get_fixed();
+				} else {
+					sizes[i] = oriented(child.measure()).first;
+				}
+
+				used += sizes[i];
+			}
+
+			if (used < space && weights > 0) {
+				size_t left    = space - used;
+				size_t given   = 0;
+				size_t running = 0;
+
+				for (size_t i = 0; i < children.size(); i++) {
+					if (children[i]->get_flex() == 0) {
+						continue;
+					}
+
+					// cumulative, so rounding never loses a cell
+					running += children[i]->get_flex();
+					sizes[i] = left * running / weights - given;
+					given   += sizes[i];
+				}
+			}
+
+			size_t pos = 0;
+
+			for (size_t i = 0; i < children.size(); i++) {
+				if (i > 0) {
+					pos += gap;
+				}
+
+				sizes[i] = pos >= space
+				           ? 0 : std::min(sizes[i], space - pos);
+				pos += sizes[i];
+			}
+
+			return sizes;
+		}
+
+		LD_DECL void Stack::blank(std::vector<std::wstring> & out, size_t width,
+		                          size_t pos, size_t count) const {
+			if (direction == HORIZONTAL) {
+				for (auto & line : out) {
+					line.append(count, L' ');
+				}
+			} else {
+				for (size_t row = pos; row < pos + count; row++) {
+					out[row].assign(width, L' ');
+				}
+			}
+		}
+
+		LD_DECL std::pair<size_t, size_t> Box::compute_size() {
+			auto size = content->measure();
+
+			return std::make_pair(
+				std::max(size.first, title.size()) + 2, size.second + 2
+			);
+		}
+
+		LD_DECL void Box::draw(size_t width, size_t height,
+		                       std::vector<std::wstring> & out) {
+			if (width < 2 || height < 2) {
+				for (auto & line : out) {
+					line.assign(width, L' ');
+				}
+
+				return;
+			}
+
+			size_t inner_width  = width - 2;
+			size_t inner_height = height - 2;
+
+			out[0].append(L"┌");
+			out[0].append(title, 0, inner_width);
+			out[0].append(inner_width - std::min(title.size(),
+			                                     inner_width), L'─');
+			out[0].append(L"┐");
+
+			const auto & lines = content->render(inner_width,
+			                                     inner_height);
+
+			for (size_t row = 0; row < inner_height; row++) {
+				out[row + 1].append(L"│");
+				out[row + 1].append(lines[row]);
+				out[row + 1].append(L"│");
+			}
+
+			out[height - 1].append(L"└");
+			out[height - 1].append(inner_width, L'─');
+			out[height - 1].append(L"┘");
+		}
+	}
+}
+#endif
+
+#endif //__LD_LAYOUT_HPP
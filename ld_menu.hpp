@@ -0,0 +1,365 @@
+#ifndef __LD_MENU_HPP
+#define __LD_MENU_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <cwctype>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "ld_config.hpp"
+#include "ld_ansi.hpp"
+#include "ld_num.hpp"
+#include "ld_output.hpp"
+#include "ld_sgr.hpp"
+#include "ld_sutil.hpp"
+#include "ld_tui.hpp"
+#include "ld_wstr.hpp"
+
+namespace LD {
+	/**
+	 * A case-insensitive substring index over a list of options. Queries of
+	 * three or more characters only look at options that contain all of the
+	 * query's trigrams, and a query that extends the previous one only
+	 * looks at the previous results, so typing into a filter over 100k
+	 * options stays well under a frame per keystroke.
+	 */
+	class OptionIndex {
+		public:
+			/**
+			 * @param options Not copied, so it has to outlive the index.
+			 */
+			explicit OptionIndex(const std::vector<std::wstring> & options)
+				: options(& options) {
+				lowered.reserve(options.size());
+
+				for (size_t i = 0; i < options.size(); i++) {
+					lowered.push_back(lower(options[i]));
+
+					const std::wstring & str = lowered.back();
+
+					for (size_t j = 0; j + 3 <= str.size(); j++) {
+						auto & ids = trigrams[trigram(str, j)];
+
+						// the same trigram can show up twice in one option
+						if (ids.empty() || ids.back() != i) {
+							ids.push_back(static_cast<uint32_t>(i));
+						}
+					}
+				}
+			}
+
+			/**
+			 * Finds every option that contains `query`, ignoring case.
+			 *
+			 * @param query
+			 * @return The indices of the matching options, in order.
+			 */
+			const std::vector<uint32_t> & search(const std::wstring & query) {
+				std::wstring needle = lower(query);
+
+				bool narrowing = !last_query.empty() &&
+				                 needle.find(last_query) != std::wstring::npos;
+
+				if (needle == last_query && has_last) {
+					return results;
+				}
+
+				std::vector<uint32_t> found;
+
+				if (needle.empty()) {
+					found.resize(lowered.size());
+
+					for (size_t i = 0; i < found.size(); i++) {
+						found[i] = static_cast<uint32_t>(i);
+					}
+				} else {
+					const std::vector<uint32_t> * candidates = nullptr;
+
+					if (narrowing && has_last) {
+						candidates = & results;
+					}
+
+					std::vector<uint32_t> intersected;
+
+					if (needle.size() >= 3) {
+						if (!intersect(needle, intersected)) {
+							return finish(needle, std::move(found));
+						}
+
+						if (candidates == nullptr ||
+						    intersected.size() < candidates->size()) {
+							candidates = & intersected;
+						}
+					}
+
+					if (candidates == nullptr) {
+						for (size_t i = 0; i < lowered.size(); i++) {
+							if (lowered[i].find(needle) != std::wstring::npos) {
+								found.push_back(static_cast<uint32_t>(i));
+							}
+						}
+					} else {
+						for (uint32_t i : * candidates) {
+							if (lowered[i].find(needle) != std::wstring::npos) {
+								found.push_back(i);
+							}
+						}
+					}
+				}
+
+				return finish(needle, std::move(found));
+			}
+
+			const std::wstring & operator[](size_t i) const {
+				return (* options)[i];
+			}
+
+			size_t size() const {
+				return lowered.size();
+			}
+
+		private:
+			const std::vector<std::wstring> * options;
+			std::vector<std::wstring>         lowered;
+
+			std::unordered_map<uint64_t, std::vector<uint32_t>> trigrams;
+
+			std::wstring          last_query;
+			bool                  has_last = false;
+			std::vector<uint32_t> results;
+
+			static std::wstring lower(const std::wstring & str) {
+				std::wstring built(str);
+
+				for (auto & ch : built) {
+					ch = static_cast<wchar_t>(std::towlower(ch));
+				}
+
+				return built;
+			}
+
+			static uint64_t trigram(const std::wstring & str, size_t i) {
+				return (uint64_t(str[i] & 0x1fffff) << 42) |
+				       (uint64_t(str[i + 1] & 0x1fffff) << 21) |
+				       uint64_t(str[i + 2] & 0x1fffff);
+			}
+
+			const std::vector<uint32_t> & finish(
+				const std::wstring & needle, std::vector<uint32_t> found) {
+				last_query = needle;
+				has_last   = true;
+				results    = std::move(found);
+
+				return results;
+			}
+
+			/**
+			 * Intersects the posting lists of every trigram in `needle`,
+			 * smallest first.
+			 *
+			 * @return false if some trigram isn't in any option at all
+			 */
+			bool intersect(const std::wstring & needle,
+			               std::vector<uint32_t> & out) const {
+				std::vector<const std::vector<uint32_t> *> lists;
+
+				for (size_t j = 0; j + 3 <= needle.size(); j++) {
+					auto it = trigrams.find(trigram(needle, j));
+
+					if (it == trigrams.end()) {
+						return false;
+					}
+
+					lists.push_back(& it->second);
+				}
+
+				std::sort(lists.begin(), lists.end(),
+				          [](const std::vector<uint32_t> * a,
+				             const std::vector<uint32_t> * b) {
+					          return a->size() < b->size();
+				          });
+
+				out = * lists[0];
+
+				std::vector<uint32_t> next;
+
+				for (size_t l = 1; l < lists.size() && !out.empty(); l++) {
+					if (lists[l] == lists[l - 1]) {
+						continue;
+					}
+
+					next.clear();
+					std::set_intersection(out.begin(), out.end(),
+					                      lists[l]->begin(), lists[l]->end(),
+					                      std::back_inserter(next));
+					out.swap(next);
+				}
+
+				return true;
+			}
+	};
+
+	/**
+	 * An interactive version of [[LD::option_menu]] for long lists. Only the
+	 * options that fit on the screen are drawn, the arrow keys, PgUp/PgDn
+	 * and Home/End move the selection, and typing filters the list (see
+	 * [[LD::OptionIndex]]). Enter picks the selected option, ESC gives up.
+	 *
+	 * Sets `selected` to the *index* of the option that was picked, or
+	 * `options.size()` if none was.
+	 *
+	 * @param options
+	 * @param selected
+	 * @param height How many options to show at once. 0 fills the
+	 * terminal.
+	 */
+	LD_DECL void search_menu(const std::vector<std::wstring> & options,
+	                         math::Unsigned & selected, size_t height = 0);
+}
+
+#if LD_DEFINITIONS
+namespace LD {
+	LD_DECL void search_menu(const std::vector<std::wstring> & options,
+	                         math::Unsigned & selected, size_t height) {
+		using TUI::Keys;
+
+		OptionIndex index(options);
+
+		std::wstring query;
+		size_t       cursor = 0; // position in the filtered list
+		size_t       top    = 0; // first filtered option on screen
+
+		TUI::RawMode raw;
+
+		// undone by the raw mode session too, if it's cut short
+		TUI::RawMode::alt_screen(true);
+		TUI::RawMode::hide_cursor(true);
+
+		selected = options.size();
+
+		while (true) {
+			auto size = TUI::terminal_size();
+
+			// one line for the query, one for the status
+			size_t rows = height;
+
+			if (rows == 0 || rows > size.second - 2) {
+				rows = size.second > 2 ? size.second - 2 : 1;
+			}
+
+			const std::vector<uint32_t> & matches = index.search(query);
+
+			if (cursor >= matches.size()) {
+				cursor = matches.empty() ? 0 : matches.size() - 1;
+			}
+
+			if (cursor < top) {
+				top = cursor;
+			} else if (cursor >= top + rows) {
+				top = cursor - rows + 1;
+			}
+
+			std::wstring frame = ANSI::c_home();
+
+			frame.append(L"> ");
+			frame.append(query);
+			frame.append(ANSI::erase_line(ANSI::ELINEFROMC));
+
+			for (size_t row = 0; row < rows; row++) {
+				size_t i = top + row;
+
+				frame.append(L"\r\n");
+
+				if (i < matches.size()) {
+					std::wstring line = wtostring(matches[i]) + L") " +
+					                    index[matches[i]];
+
+					if (line.size() > size.first) {
+						line.resize(size.first);
+					}
+
+					if (i == cursor) {
+						frame.append(SGR::SGR({SGR::REVERSE}));
+						frame.append(line);
+						frame.append(SGR::reset());
+					} else {
+						frame.append(line);
+					}
+				}
+
+				frame.append(ANSI::erase_line(ANSI::ELINEFROMC));
+			}
+
+			frame.append(L"\r\n");
+			frame.append(wtostring(matches.size()) + L"/" +
+			             wtostring(options.size()));
+			frame.append(ANSI::erase_line(ANSI::ELINEFROMC));
+
+			ofl(frame);
+
+			Keys::Key key = TUI::getch();
+
+			switch (Keys::base(key)) {
+				case Keys::UP:
+					cursor = cursor > 0 ? cursor - 1 : 0;
+
+					break;
+				case Keys::DOWN:
+					cursor++;
+
+					break;
+				case Keys::PAGE_UP:
+					cursor = cursor > rows ? cursor - rows : 0;
+
+					break;
+				case Keys::PAGE_DOWN:
+					cursor += rows;
+
+					break;
+				case Keys::HOME:
+					cursor = 0;
+
+					break;
+				case Keys::END:
+					cursor = matches.empty() ? 0 : matches.size() - 1;
+
+					break;
+				case Keys::CR:
+				case Keys::LF:
+					if (!matches.empty()) {
+						selected = matches[cursor];
+					}
+				// fall through
+				case Keys::NUL:
+				case Keys::ESC:
+					TUI::RawMode::hide_cursor(false);
+					TUI::RawMode::alt_screen(false);
+
+					return;
+				case Keys::BS:
+				case Keys::DELETE:
+					if (!query.empty()) {
+						query.pop_back();
+					}
+
+					break;
+				case Keys::PASTE:
+					query.append(s2wstr(TUI::KeyDecoder::shared().take_paste()));
+					cursor = 0;
+
+					break;
+				default:
+					if (Keys::mods(key) == 0 && key >= Keys::SPACE &&
+					    key < Keys::DELETE) {
+						query.append(1, static_cast<wchar_t>(key));
+						cursor = 0;
+					}
+			}
+		}
+	}
+}
+#endif
+
+#endif //__LD_MENU_HPP
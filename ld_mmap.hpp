@@ -0,0 +1,161 @@
+#ifndef __LD_MMAP_HPP
+#define __LD_MMAP_HPP
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace LD {
+	/**
+	 * A read-only memory mapping of a regular file. The contents are
+	 * available as one big [[std::string_view]] without being copied, and the
+	 * kernel pages them in as they're touched.
+	 */
+	class MappedFile {
+		public:
+			MappedFile() = default;
+
+			/**
+			 * Maps the file at `path`. Throws [[std::runtime_error]] if it
+			 * can't be opened or isn't a regular file.
+			 *
+			 * @param path
+			 */
+			explicit MappedFile(const std::string & path) {
+				int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+
+				if (fd < 0) {
+					throw std::runtime_error("can't open " + path);
+				}
+
+				bool ok = map(fd, 0);
+
+				close(fd);
+
+				if (!ok) {
+					throw std::runtime_error("can't map " + path);
+				}
+			}
+
+			/**
+			 * Maps an already open file from `offset` to the end. Doesn't
+			 * throw, check [[valid]] instead, since the fd might be a pipe
+			 * or a terminal. The fd can be closed afterwards.
+			 *
+			 * @param fd
+			 * @param offset
+			 */
+			MappedFile(int fd, off_t offset) {
+				map(fd, offset);
+			}
+
+			~MappedFile() {
+				unmap();
+			}
+
+			MappedFile(const MappedFile &) = delete;
+			MappedFile & operator=(const MappedFile &) = delete;
+
+			MappedFile(MappedFile && other) noexcept {
+				* this = std::move(other);
+			}
+
+			MappedFile & operator=(MappedFile && other) noexcept {
+				if (this != & other) {
+					unmap();
+
+					base       = other.base;
+					base_len   = other.base_len;
+					start      = other.start;
+					len        = other.len;
+					is_valid   = other.is_valid;
+
+					other.base     = nullptr;
+					other.base_len = 0;
+					other.start    = nullptr;
+					other.len      = 0;
+					other.is_valid = false;
+				}
+
+				return * this;
+			}
+
+			/**
+			 * @return Whether the file was mapped. An empty file is valid,
+			 * there's just nothing in it.
+			 */
+			bool valid() const {
+				return is_valid;
+			}
+
+			const char * data() const {
+				return start;
+			}
+
+			size_t size() const {
+				return len;
+			}
+
+			std::string_view view() const {
+				return std::string_view(start, len);
+			}
+
+		private:
+			void         * base     = nullptr;
+			size_t       base_len   = 0;
+			const char   * start    = nullptr;
+			size_t       len        = 0;
+			bool         is_valid   = false;
+
+			bool map(int fd, off_t offset) {
+				struct stat st {};
+
+				if (fstat(fd, & st) != 0 || !S_ISREG(st.st_mode)) {
+					return false;
+				}
+
+				if (offset >= st.st_size) {
+					return is_valid = true;
+				}
+
+				// mmap offsets have to be page aligned
+				off_t page    = sysconf(_SC_PAGESIZE);
+				off_t aligned = offset - offset % page;
+
+				base_len = static_cast<size_t>(st.st_size - aligned);
+				base     = mmap(nullptr, base_len, PROT_READ, MAP_PRIVATE, fd,
+				                aligned);
+
+				if (base == MAP_FAILED) {
+					base     = nullptr;
+					base_len = 0;
+
+					return false;
+				}
+
+				madvise(base, base_len, MADV_SEQUENTIAL);
+
+				start = static_cast<const char *>(base) + (offset - aligned);
+				len   = static_cast<size_t>(st.st_size - offset);
+
+				return is_valid = true;
+			}
+
+			void unmap() {
+				if (base != nullptr) {
+					munmap(base, base_len);
+				}
+
+				base     = nullptr;
+				base_len = 0;
+			}
+	};
+}
+
+#endif //__LD_MMAP_HPP
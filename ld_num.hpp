@@ -1,12 +1,38 @@
 #ifndef __LD_NUM_HPP
 #define __LD_NUM_HPP
 
+#include <algorithm>
 #include <string>
 #include <sstream>
+#include <vector>
 
 #include "precision/math_Rational.h"
 
+#include "ld_config.hpp"
+#include "ld_wstr.hpp"
+
 namespace LD {
+	/**
+	 * Same as [[LD::wtostring]], but works with Unsigned/Rational/etc.
+	 *
+	 * @param src
+	 * @return
+	 */
+	template <>
+		inline std::wstring wtostring<math::Unsigned>(const math::Unsigned & src) {
+			return s2wstr(src.to_string());
+		}
+
+	template <>
+		inline std::wstring wtostring<math::Integer>(const math::Integer & src) {
+			return s2wstr(src.to_string());
+		}
+
+	template <>
+		inline std::wstring wtostring<math::Rational>(const math::Rational & src) {
+			return s2wstr(src.to_string());
+		}
+
 	/**
 	 * This is not mine, this is Elias Yarrkov's: https://stackoverflow.com/a/101613
 	 *
@@ -45,7 +71,7 @@ namespace LD {
 	 * @param exp
 	 * @return
 	 */
-	math::Rational rpow(const math::Rational & src,
+	inline math::Rational rpow(const math::Rational & src,
 	                    const math::Integer & exp) {
 		return math::Rational(ipow(src.numerator(), exp),
 		                      ipow(src.denominator(), exp));
@@ -58,7 +84,7 @@ namespace LD {
 	 * @param rhs
 	 * @return
 	 */
-	math::Rational rmod(const math::Rational & lhs,
+	inline math::Rational rmod(const math::Rational & lhs,
 	                    const math::Rational & rhs) {
 		math::Integer cd = lhs.denominator() * rhs.denominator();
 		math::Integer ln = lhs.numerator() * cd;
@@ -88,6 +114,444 @@ namespace LD {
 
 			return target;
 		}
+
+	enum DecimalNotation {
+		FIXED,      // 123.456
+		SCIENTIFIC, // 1.23456e+02
+		REPEATING   // 0.1(6), exact
+	};
+
+	/**
+	 * Appends `value` to `out` in decimal. The expansion is worked out a
+	 * block of up to 18 digits per big division, so the cost grows
+	 * linearly with the number of digits, and nothing is allocated per
+	 * digit. Rounding is exact, half away from zero.
+	 *
+	 * `out` can be any string type, narrow or wide.
+	 *
+	 * @param out
+	 * @param value
+	 * @param digits For [[FIXED]], digits after the point. For
+	 * [[SCIENTIFIC]], digits after the point of the mantissa. For
+	 * [[REPEATING]], the most digits after the point to show; if the
+	 * expansion doesn't end or repeat within that many, the digits so far
+	 * are followed by "...". A value that rounds to zero is shown without
+	 * a sign.
+	 * @param notation
+	 */
+	LD_DECL void append_decimal(std::string & out, const math::Rational & value,
+	                            size_t digits, DecimalNotation notation = FIXED);
+
+	/**
+	 * Same as [[LD::append_decimal]], for any other string type.
+	 */
+	template <class Str>
+		void append_decimal(Str & out, const math::Rational & value,
+		                    size_t digits, DecimalNotation notation = FIXED) {
+			// worked out in ASCII, then widened
+			thread_local std::string narrow;
+
+			narrow.clear();
+			append_decimal(narrow, value, digits, notation);
+			out.append(narrow.begin(), narrow.end());
+		}
+
+	/**
+	 * [[LD::append_decimal]] into a new string. Unlike
+	 * [[LD::wtostring]], which gives `num/den`.
+	 *
+	 * @param value
+	 * @param digits
+	 * @param notation
+	 * @return
+	 */
+	LD_DECL std::wstring to_decimal(const math::Rational & value,
+	                                size_t digits = 6,
+	                                DecimalNotation notation = FIXED);
+}
+
+#if LD_DEFINITIONS
+namespace LD {
+	namespace _num {
+		/**
+		 * How many digits to get out of each big division: the most that
+		 * always fit in a long long.
+		 */
+		inline constexpr size_t BLOCK = 18;
+
+		/**
+		 * @return 10^k, for k up to [[BLOCK]]
+		 */
+		inline const math::Integer & pow10(size_t k) {
+			static const auto table = [] {
+				std::vector<math::Integer> powers;
+				long long                  power = 1;
+
+				for (size_t i = 0; i <= BLOCK; i++) {
+					powers.emplace_back(power);
+					power *= 10;
+				}
+
+				return powers;
+			}();
+
+			return table[k];
+		}
+
+		/**
+		 * The decimal expansion of a non-negative fraction, produced a
+		 * block of digits per division instead of one.
+		 */
+		class Expansion {
+			public:
+				Expansion(const math::Integer & num, const math::Integer & den)
+					: den(den), whole(num / den), rem(num % den) {}
+
+				/**
+				 * @return The digits before the point.
+				 */
+				std::string integer_digits() const {
+					return whole.to_string();
+				}
+
+				bool integer_zero() const {
+					return whole == 0;
+				}
+
+				/**
+				 * @return Whether every digit from here on is 0.
+				 */
+				bool exhausted() const {
+					return rem == 0;
+				}
+
+				/**
+				 * Appends the next `count` digits after the point.
+				 */
+				void digits(std::string & out, size_t count) {
+					while (count > 0) {
+						if (rem == 0) {
+							out.append(count, '0');
+
+							return;
+						}
+
+						size_t k = std::min(count, BLOCK);
+
+						append_block(out, k);
+						count -= k;
+					}
+				}
+
+				/**
+				 * Skips the zeros right after the point, up to the first digit
+				 * that isn't, then appends that digit and the rest of its
+				 * block. Only call it if the expansion isn't [[exhausted]].
+				 *
+				 * @return How many zeros were skipped
+				 */
+				size_t skip_zeros(std::string & out) {
+					size_t zeros = 0;
+
+					while (true) {
+						std::string block;
+
+						append_block(block, BLOCK);
+
+						size_t first = block.find_first_not_of('0');
+
+						if (first != std::string::npos) {
+							out.append(block, first, std::string::npos);
+
+							return zeros + first;
+						}
+
+						zeros += BLOCK;
+					}
+				}
+
+			private:
+				math::Integer den;
+				math::Integer whole;
+				math::Integer rem;
+
+				void append_block(std::string & out, size_t k) {
+					rem = rem * pow10(k);
+
+					math::Integer block = rem / den;
+					std::string   text  = block.to_string();
+
+					rem = rem - block * den;
+
+					out.append(k - text.size(), '0');
+					out.append(text);
+				}
+		};
+
+		/**
+		 * Rounds `digits` to its first `keep` digits, half away from zero,
+		 * using the digit after them. Every digit comes from the exact
+		 * expansion, so that one digit is enough to round correctly.
+		 *
+		 * @return Whether a carry made the number a digit longer, like
+		 * 999.96 becoming 1000.0
+		 */
+		inline bool round_digits(std::string & digits, size_t keep) {
+			bool up = keep < digits.size() && digits[keep] >= '5';
+
+			digits.resize(keep);
+
+			if (!up) {
+				return false;
+			}
+
+			for (size_t i = keep; i-- > 0;) {
+				if (digits[i] != '9') {
+					digits[i]++;
+
+					return false;
+				}
+
+				digits[i] = '0';
+			}
+
+			digits.insert(digits.begin(), '1');
+
+			return true;
+		}
+
+		inline void put(std::string & out, const std::string & text) {
+			out.append(text.begin(), text.end());
+		}
+
+		inline void put(std::string & out, const std::string & text,
+		                size_t from, size_t count) {
+			out.append(text.begin() + from, text.begin() + from + count);
+		}
+
+		inline void put_fixed(std::string & out, Expansion & expansion,
+		                      size_t digits) {
+			std::string all = expansion.integer_digits();
+			size_t      point = all.size();
+
+			// one more than asked for, to round with
+			expansion.digits(all, digits + 1);
+
+			if (round_digits(all, point + digits)) {
+				point++;
+			}
+
+			put(out, all, 0, point);
+
+			if (digits > 0) {
+				out.append(1, '.');
+				put(out, all, point, digits);
+			}
+		}
+
+		inline void put_scientific(std::string & out, Expansion & expansion,
+		                           size_t digits) {
+			std::string significant;
+			long long   exponent = 0;
+
+			if (!expansion.integer_zero()) {
+				significant = expansion.integer_digits();
+				exponent    = static_cast<long long>(significant.size()) - 1;
+			} else if (!expansion.exhausted()) {
+				exponent = -static_cast<long long>(
+					expansion.skip_zeros(significant)
+				) - 1;
+			}
+
+			if (significant.empty()) {
+				significant = "0";
+			}
+
+			if (significant.size() < digits + 2) {
+				expansion.digits(significant,
+				                 digits + 2 - significant.size());
+			}
+
+			if (round_digits(significant, digits + 1)) {
+				significant.pop_back();
+				exponent++;
+			}
+
+			out.append(1, significant[0]);
+
+			if (digits > 0) {
+				out.append(1, '.');
+				put(out, significant, 1, digits);
+			}
+
+			out.append(1, 'e');
+			out.append(1, exponent < 0 ? '-' : '+');
+
+			std::string exp = std::to_string(exponent < 0 ? -exponent
+			                                              : exponent);
+
+			if (exp.size() < 2) {
+				out.append(1, '0');
+			}
+
+			put(out, exp);
+		}
+
+		inline math::Integer gcd(math::Integer a, math::Integer b) {
+			while (b != 0) {
+				math::Integer next = a % b;
+
+				a = b;
+				b = next;
+			}
+
+			return a;
+		}
+
+		/**
+		 * @return How many times `num` divides by `factor`, after dividing
+		 * it out.
+		 */
+		inline size_t remove_factor(math::Integer & num, long long factor) {
+			size_t count = 0;
+
+			while (num % factor == 0) {
+				num = num / factor;
+				count++;
+			}
+
+			return count;
+		}
+
+		inline void put_repeating(std::string & out, math::Integer num,
+		                          math::Integer den, size_t max_digits) {
+			math::Integer divisor = gcd(num, den);
+
+			if (divisor != 0 && divisor != 1) {
+				num = num / divisor;
+				den = den / divisor;
+			}
+
+			// the digits before the repeating part come from the 2s and
+			// 5s in the denominator, the length of the repeating part is
+			// the order of 10 modulo what's left
+			math::Integer rest  = den;
+			size_t        twos  = remove_factor(rest, 2);
+			size_t        fives = remove_factor(rest, 5);
+			size_t        head  = std::max(twos, fives);
+
+			Expansion expansion(num, den);
+
+			put(out, expansion.integer_digits());
+
+			// the digits before the repeating part alone are too many
+			if (head > max_digits || (rest != 1 && head == max_digits)) {
+				if (max_digits > 0) {
+					std::string tail;
+
+					expansion.digits(tail, max_digits);
+					out.append(1, '.');
+					put(out, tail);
+				}
+
+				out.append(3, '.');
+
+				return;
+			}
+
+			if (rest == 1) {
+				if (head > 0) {
+					std::string tail;
+
+					expansion.digits(tail, head);
+					out.append(1, '.');
+					put(out, tail);
+				}
+
+				return;
+			}
+
+			size_t        period = 1;
+			math::Integer power  = math::Integer(10) % rest;
+
+			while (power != 1 && head + period < max_digits) {
+				power = power * 10 % rest;
+				period++;
+			}
+
+			std::string tail;
+
+			expansion.digits(tail, head + period);
+			out.append(1, '.');
+			put(out, tail, 0, head);
+
+			if (power != 1) {
+				// too long to show all of it
+				put(out, tail, head, period);
+				out.append(3, '.');
+
+				return;
+			}
+
+			out.append(1, '(');
+			put(out, tail, head, period);
+			out.append(1, ')');
+		}
+	}
+
+	LD_DECL void append_decimal(std::string & out, const math::Rational & value,
+	                            size_t digits, DecimalNotation notation) {
+		math::Integer num = value.numerator();
+		math::Integer den = value.denominator();
+
+		bool   negative = (num < 0) != (den < 0) && num != 0;
+		size_t start    = out.size();
+
+		num = abs(num);
+		den = abs(den);
+
+		if (notation == REPEATING) {
+			_num::put_repeating(out, num, den, digits);
+		} else {
+			_num::Expansion expansion(num, den);
+
+			if (notation == SCIENTIFIC) {
+				_num::put_scientific(out, expansion, digits);
+			} else {
+				_num::put_fixed(out, expansion, digits);
+			}
+		}
+
+		if (!negative) {
+			return;
+		}
+
+		// no "-0.00" if the value rounded to zero; a REPEATING that
+		// was cut off still shows its sign, since it isn't rounded
+		bool nonzero = notation == REPEATING;
+
+		for (size_t i = start; i < out.size() && !nonzero; i++) {
+			if (out[i] == 'e') {
+				break;
+			}
+
+			nonzero = out[i] >= '1' && out[i] <= '9';
+		}
+
+		if (nonzero) {
+			out.insert(start, 1, '-');
+		}
+	}
+
+	LD_DECL std::wstring to_decimal(const math::Rational & value, size_t digits,
+	                                DecimalNotation notation) {
+		std::wstring result;
+
+		append_decimal(result, value, digits, notation);
+
+		return result;
+	}
 }
+#endif
 
 #endif //__LD_NUM_HPP
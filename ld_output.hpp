@@ -1,45 +1,64 @@
 #ifndef __LD_OUTPUT_HPP
 #define __LD_OUTPUT_HPP
 
-#include <iostream>
+#include <functional>
 #include <string>
+#include <string_view>
 
-#include "ld_termcolor.hpp"
+#include "ld_config.hpp"
+#include "ld_trace.hpp"
 
 namespace LD {
+	using OutputSink = std::function<void(std::wstring_view)>;
+
+	/**
+	 * Where [[LD::o]] sends its output instead of stdout, if anything. See
+	 * [[LD::set_output_sink]].
+	 */
+	inline OutputSink & output_sink() {
+		static OutputSink sink;
+
+		return sink;
+	}
+
+	/**
+	 * Sends everything written with [[LD::o]] (and everything built on it,
+	 * plus [[LD::nl]] and the frames from [[LD::FrameScheduler]]) to `sink`
+	 * instead of stdout, for example to capture it in a
+	 * [[LD::VirtualTerminal]] in a test. An empty sink goes back to stdout.
+	 *
+	 * @param sink
+	 * @return The sink that was set before.
+	 */
+	inline OutputSink set_output_sink(OutputSink sink) {
+		std::swap(output_sink(), sink);
+
+		return sink;
+	}
+
 	/**
 	 * Outputs `text`.
 	 *
 	 * @param text The text to output.
 	 */
-	void o(const std::wstring & text) {
-		//std::wcout << text;
-		std::wprintf(text.c_str());
-	}
+	LD_DECL void o(const std::wstring & text);
 
 	/**
 	 * Flushes stdout after [[LD::o]].
 	 */
-	void fl() {
-		std::wcout << std::flush;
-	}
+	LD_DECL void fl();
 
 	/**
 	 * Outputs `text`, then flushes the output.
 	 *
 	 * @param text The text to output.
 	 */
-	void ofl(const std::wstring & text) {
-		o(text);
-		fl();
-	}
+	LD_DECL void ofl(const std::wstring & text);
 
 	/**
 	 * Newline.
 	 */
-	void nl() {
-		std::wcout << std::endl;
-	}
+	LD_DECL void nl();
 
 	/**
 	 * Logs a message to [[std::wcout]] using [[LOG_STYLE]]. This does flush
@@ -47,7 +66,75 @@ namespace LD {
 	 *
 	 * @param message The message to log.
 	 */
-	void log(const std::wstring & message) {
+	LD_DECL void log(const std::wstring & message);
+
+	/**
+	 * [[LD::log]] with a newline.
+	 *
+	 * @param message
+	 */
+	LD_DECL void lognl(const std::wstring & message);
+
+	/**
+	 * Logs a message to [[std::wcout]] using [[ERR_STYLE]]. This does flush
+	 * afterwards.
+	 *
+	 * @param message The message to log.
+	 */
+	LD_DECL void err(const std::wstring & message);
+
+	/**
+	 * [[LD::err]] with a newline.
+	 *
+	 * @param message
+	 */
+	LD_DECL void errnl(const std::wstring & message);
+}
+
+#if LD_DEFINITIONS
+#include <cstdio>
+#include <iostream>
+
+#include "ld_termcolor.hpp"
+
+namespace LD {
+	LD_DECL void o(const std::wstring & text) {
+		LD_STAT(WRITES, 1);
+		LD_STAT(CHARS_WRITTEN, text.size());
+
+		if (output_sink()) {
+			output_sink()(text);
+
+			return;
+		}
+
+		//std::wcout << text;
+		std::wprintf(L"%ls", text.c_str());
+	}
+
+	LD_DECL void fl() {
+		LD_STAT(FLUSHES, 1);
+		LD_TRACE_SCOPE("LD::fl");
+
+		std::wcout << std::flush;
+	}
+
+	LD_DECL void ofl(const std::wstring & text) {
+		o(text);
+		fl();
+	}
+
+	LD_DECL void nl() {
+		if (output_sink()) {
+			output_sink()(L"\n");
+
+			return;
+		}
+
+		std::wcout << std::endl;
+	}
+
+	LD_DECL void log(const std::wstring & message) {
 		// @formatter:off
 		#ifdef LD_USE_TERMCOLOR
 			o(LOG_STYLE + message + GET_ANSI(termcolor::reset));
@@ -59,23 +146,12 @@ namespace LD {
 		// @formatter:on
 	}
 
-	/**
-	 * [[LD::log]] with a newline.
-	 *
-	 * @param message
-	 */
-	void lognl(const std::wstring & message) {
+	LD_DECL void lognl(const std::wstring & message) {
 		log(message);
 		nl();
 	}
 
-	/**
-	 * Logs a message to [[std::wcout]] using [[ERR_STYLE]]. This does flush
-	 * afterwards.
-	 *
-	 * @param message The message to log.
-	 */
-	void err(const std::wstring & message) {
+	LD_DECL void err(const std::wstring & message) {
 		// @formatter:off
 		#ifdef LD_USE_TERMCOLOR
 			o(ERR_STYLE + message + GET_ANSI(termcolor::reset));
@@ -87,15 +163,11 @@ namespace LD {
 		// @formatter:on
 	}
 
-	/**
-	 * [[LD::err]] with a newline.
-	 *
-	 * @param message
-	 */
-	void errnl(const std::wstring & message) {
+	LD_DECL void errnl(const std::wstring & message) {
 		err(message);
 		nl();
 	}
 }
+#endif
 
 #endif //__LD_OUTPUT_HPP
@@ -0,0 +1,471 @@
+#ifndef __LD_PANE_HPP
+#define __LD_PANE_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "ld_config.hpp"
+#include "ld_ansi.hpp"
+#include "ld_frame.hpp"
+#include "ld_output.hpp"
+#include "ld_trace.hpp"
+#include "ld_tui.hpp"
+
+namespace LD {
+	/**
+	 * A rectangle of the screen owned by one worker thread. The worker
+	 * writes to it through a lock-free single-producer, single-consumer
+	 * queue, and [[LD::PaneManager]]'s compositor thread is the only
+	 * consumer, so writing never waits for the terminal or for other
+	 * panes.
+	 *
+	 * Text is appended like to a small terminal: newlines start a new line
+	 * and scroll the pane once it's full, and `\r` clears the current line,
+	 * so status lines can be redrawn in place. Lines that are too long are
+	 * cut off.
+	 */
+	class Pane {
+		public:
+			Pane(size_t x, size_t y, size_t width, size_t height,
+			     size_t queue_size)
+				: x(x), y(y), w(width), h(height),
+				  capacity(std::max<size_t>(queue_size, 1)),
+				  slots(new Message[capacity]) {}
+
+			Pane(const Pane &) = delete;
+			Pane & operator=(const Pane &) = delete;
+
+			/**
+			 * Appends `text`. If the queue is full, waits for the compositor
+			 * to catch up instead of dropping it. Only one thread can write
+			 * to a pane.
+			 *
+			 * @param text
+			 */
+			void write(std::wstring_view text) {
+				while (!try_push(false, text)) {
+					std::this_thread::yield();
+				}
+			}
+
+			/**
+			 * Replaces everything in the pane with `text`.
+			 *
+			 * @param text
+			 */
+			void set(std::wstring_view text) {
+				while (!try_push(true, text)) {
+					std::this_thread::yield();
+				}
+			}
+
+			/**
+			 * [[write]], but gives up instead of waiting if the queue is
+			 * full.
+			 *
+			 * @param text
+			 * @return Whether it was queued
+			 */
+			bool try_write(std::wstring_view text) {
+				return try_push(false, text);
+			}
+
+			size_t left() const {
+				return x;
+			}
+
+			size_t top() const {
+				return y;
+			}
+
+			size_t width() const {
+				return w;
+			}
+
+			size_t height() const {
+				return h;
+			}
+
+		private:
+			friend class PaneManager;
+
+			struct Message {
+				bool         replace = false;
+				std::wstring text;
+			};
+
+			const size_t x;
+			const size_t y;
+			const size_t w;
+			const size_t h;
+
+			const size_t               capacity;
+			std::unique_ptr<Message[]> slots;
+
+			// on their own cache lines, so the producer and the consumer
+			// don't keep taking them from each other
+			alignas(64) std::atomic<size_t> head {0}; // next to read
+			alignas(64) std::atomic<size_t> tail {0}; // next to write
+
+			// only touched by the compositor
+			alignas(64) std::vector<std::wstring> lines;
+			bool                                  dirty = true;
+
+			bool try_push(bool replace, std::wstring_view text);
+
+			/**
+			 * Applies everything that's been queued.
+			 *
+			 * @return Whether there was anything
+			 */
+			bool drain();
+
+			void append(const std::wstring & text);
+	};
+
+	/**
+	 * Splits the terminal into [[LD::Pane]]s that worker threads write to
+	 * on their own, and runs a compositor thread that, at most `fps` times
+	 * a second, takes whatever the panes have queued and draws it. Only
+	 * the cells that changed since the last frame are sent, as runs placed
+	 * with [[LD::ANSI::c_mov]], and each frame is one write through a
+	 * [[LD::FrameScheduler]]. Panes are clipped to the terminal.
+	 *
+	 *     LD::PaneManager panes;
+	 *     auto size = LD::TUI::terminal_size();
+	 *
+	 *     for (size_t i = 0; i < workers; i++) {
+	 *         LD::Pane & pane = panes.add_pane(0, i * 4, size.first, 4);
+	 *
+	 *         threads.emplace_back([& pane] {
+	 *             pane.write(L"\rworking...");
+	 *         });
+	 *     }
+	 */
+	class PaneManager {
+		public:
+			/**
+			 * @param fps The most frames to draw per second.
+			 * @param alt_screen Whether to draw on the alternate screen, so
+			 * whatever was on the terminal comes back afterwards. The
+			 * terminal is in [[LD::TUI::RawMode]] while the panes are up.
+			 */
+			explicit PaneManager(double fps = 30, bool alt_screen = true)
+				: interval(std::chrono::duration_cast<
+					std::chrono::steady_clock::duration
+				>(std::chrono::duration<double>(1 / (fps > 0 ? fps : 30)))),
+				  frames(fps), alt_screen(alt_screen) {
+				if (alt_screen) {
+					TUI::RawMode::alt_screen(true);
+				}
+
+				TUI::RawMode::hide_cursor(true);
+				ofl(ANSI::erase_screen(ANSI::ESCREEN));
+
+				thread = std::thread([this] {
+					run();
+				});
+			}
+
+			/**
+			 * Draws one last frame and gives the terminal back.
+			 */
+			~PaneManager() {
+				stop();
+			}
+
+			PaneManager(const PaneManager &) = delete;
+			PaneManager & operator=(const PaneManager &) = delete;
+
+			/**
+			 * Adds a pane. The returned pane lives as long as this
+			 * [[LD::PaneManager]].
+			 *
+			 * @param x
+			 * @param y
+			 * @param width
+			 * @param height
+			 * @param queue_size How many writes can be waiting to be drawn
+			 * before [[LD::Pane::write]] has to wait.
+			 * @return
+			 */
+			Pane & add_pane(size_t x, size_t y, size_t width, size_t height,
+			                size_t queue_size = 256) {
+				std::lock_guard<std::mutex> guard(lock);
+
+				panes.push_back(std::make_unique<Pane>(x, y, width, height,
+				                                       queue_size));
+
+				return * panes.back();
+			}
+
+			/**
+			 * Stops the compositor after one last frame. Called by the
+			 * destructor; calling it more than once is fine.
+			 */
+			void stop();
+
+			/**
+			 * @return How many frames have been drawn.
+			 */
+			size_t frame_count() const {
+				return frames.frame_count();
+			}
+
+		private:
+			// brings the cursor and the main screen back, even on a signal
+			TUI::RawMode raw;
+
+			std::chrono::steady_clock::duration interval;
+			FrameScheduler                      frames;
+			bool                                alt_screen;
+
+			std::mutex                         lock; // only guards panes
+			std::vector<std::unique_ptr<Pane>> panes;
+
+			std::atomic<bool> stopping {false};
+			std::thread       thread;
+
+			// only touched by the compositor
+			size_t                cols = 0;
+			size_t                rows = 0;
+			std::vector<wchar_t>  shown; // what the terminal has
+			std::vector<wchar_t>  next;  // what it should have
+			std::wstring          frame;
+
+			/**
+			 * Unchanged cells shorter than this between two changed ones
+			 * are sent again instead of moving the cursor over them, since
+			 * a move costs about that much.
+			 */
+			static constexpr size_t MAX_GAP = 6;
+
+			void run();
+
+			void compose();
+
+			/**
+			 * Copies the pane into [[next]], clipped to the screen.
+			 */
+			void paint(const Pane & pane);
+
+			/**
+			 * Appends what it takes to turn [[shown]] into [[next]] to
+			 * [[frame]].
+			 */
+			void diff();
+	};
+}
+
+#if LD_DEFINITIONS
+namespace LD {
+	LD_DECL bool Pane::try_push(bool replace, std::wstring_view text) {
+		size_t at = tail.load(std::memory_order_relaxed);
+
+		if (at - head.load(std::memory_order_acquire) == capacity) {
+			return false;
+		}
+
+		Message & slot = slots[at % capacity];
+
+		// reuses the slot's buffer, so a warmed-up queue doesn't
+		// allocate
+		slot.replace = replace;
+		slot.text.assign(text);
+
+		tail.store(at + 1, std::memory_order_release);
+
+		return true;
+	}
+
+	LD_DECL bool Pane::drain() {
+		size_t from = head.load(std::memory_order_relaxed);
+		size_t to   = tail.load(std::memory_order_acquire);
+
+		for (size_t at = from; at < to; at++) {
+			const Message & slot = slots[at % capacity];
+
+			if (slot.replace) {
+				lines.clear();
+			}
+
+			append(slot.text);
+			head.store(at + 1, std::memory_order_release);
+		}
+
+		if (to != from) {
+			dirty = true;
+		}
+
+		return to != from;
+	}
+
+	LD_DECL void Pane::append(const std::wstring & text) {
+		if (lines.empty()) {
+			lines.emplace_back();
+		}
+
+		for (wchar_t ch : text) {
+			if (ch == L'\n') {
+				lines.emplace_back();
+
+				if (lines.size() > h) {
+					lines.erase(lines.begin());
+				}
+			} else if (ch == L'\r') {
+				lines.back().clear();
+			} else if (lines.back().size() < w) {
+				lines.back().push_back(ch);
+			}
+		}
+	}
+
+	LD_DECL void PaneManager::stop() {
+		if (stopping.exchange(true)) {
+			return;
+		}
+
+		thread.join();
+
+		ofl(ANSI::c_mov(0, rows > 0 ? rows - 1 : 0));
+		TUI::RawMode::hide_cursor(false);
+
+		if (alt_screen) {
+			TUI::RawMode::alt_screen(false);
+		}
+	}
+
+	LD_DECL void PaneManager::run() {
+		bool last = false;
+
+		while (!last) {
+			std::this_thread::sleep_for(interval);
+
+			last = stopping.load();
+			compose();
+		}
+	}
+
+	LD_DECL void PaneManager::compose() {
+		LD_TRACE_SCOPE("LD::PaneManager::compose");
+
+		auto size = TUI::terminal_size();
+
+		frame.clear();
+
+		if (size.first != cols || size.second != rows) {
+			cols = size.first;
+			rows = size.second;
+
+			shown.assign(cols * rows, L' ');
+			next.assign(cols * rows, L' ');
+			frame.append(ANSI::erase_screen(ANSI::ESCREEN));
+
+			std::lock_guard<std::mutex> guard(lock);
+
+			for (auto & pane : panes) {
+				pane->dirty = true;
+			}
+		}
+
+		{
+			std::lock_guard<std::mutex> guard(lock);
+
+			for (auto & pane : panes) {
+				pane->drain();
+
+				if (pane->dirty) {
+					paint(* pane);
+					pane->dirty = false;
+				}
+			}
+		}
+
+		diff();
+
+		if (!frame.empty()) {
+			frames.write(frame);
+			frames.flush();
+		}
+	}
+
+	LD_DECL void PaneManager::paint(const Pane & pane) {
+		if (pane.x >= cols || pane.y >= rows) {
+			return;
+		}
+
+		size_t width  = std::min(pane.w, cols - pane.x);
+		size_t height = std::min(pane.h, rows - pane.y);
+
+		for (size_t row = 0; row < height; row++) {
+			wchar_t * cells = & next[(pane.y + row) * cols + pane.x];
+			size_t    used  = 0;
+
+			if (row < pane.lines.size()) {
+				const std::wstring & line = pane.lines[row];
+
+				used = std::min(line.size(), width);
+				std::copy_n(line.begin(), used, cells);
+			}
+
+			std::fill(cells + used, cells + width, L' ');
+		}
+	}
+
+	LD_DECL void PaneManager::diff() {
+		// where the cursor is, if known
+		size_t cx = cols;
+		size_t cy = rows;
+
+		for (size_t y = 0; y < rows; y++) {
+			const wchar_t * want = & next[y * cols];
+			wchar_t       * have = & shown[y * cols];
+
+			size_t x = 0;
+
+			while (x < cols) {
+				if (want[x] == have[x]) {
+					x++;
+
+					continue;
+				}
+
+				// the run ends once MAX_GAP cells in a row match
+				size_t end   = x + 1;
+				size_t match = 0;
+
+				for (size_t i = x + 1; i < cols && match < MAX_GAP;
+				     i++) {
+					if (want[i] == have[i]) {
+						match++;
+					} else {
+						match = 0;
+						end   = i + 1;
+					}
+				}
+
+				if (cx != x || cy != y) {
+					frame.append(ANSI::c_mov(x, y));
+				}
+
+				frame.append(want + x, end - x);
+				std::copy(want + x, want + end, have + x);
+
+				// the cursor doesn't move past the last column
+				cx = end < cols ? end : cols;
+				cy = end < cols ? y : rows;
+				x  = end;
+			}
+		}
+	}
+}
+#endif
+
+#endif //__LD_PANE_HPP
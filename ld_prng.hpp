@@ -1,7 +1,10 @@
 #ifndef __LD_PRNG_HPP
 #define __LD_PRNG_HPP
 
+#include <cstdint>
+#include <limits>
 #include <random>
+#include <vector>
 
 #include "ld_wstr.hpp"
 
@@ -13,7 +16,7 @@ namespace LD {
 	 *
 	 * @return The RNG
 	 */
-	std::mt19937 get_secure_RNG() {
+	inline std::mt19937 get_secure_RNG() {
 		std::mt19937 rng;
 		rng.seed(std::random_device()());
 
@@ -21,25 +24,247 @@ namespace LD {
 	}
 
 	/**
-	 * Generates an RNG using a seed from an [[std::random_device]].
+	 * Generates a random number between `min` and `max`, inclusive, using
+	 * `rng`. Works with [[std::mt19937]] as well as [[LD::Xoshiro256]].
 	 *
 	 * See https://stackoverflow.com/a/13445752 & [[wander]]
 	 *
-	 * @return The RNG
+	 * @tparam Engine
+	 * @param rng
+	 * @param min
+	 * @param max
+	 * @return The random number
 	 */
-	int get_rn(std::mt19937 & rng, int min, int max) {
-		if (min > max) {
-			std::swap(max, min);
+	template <class Engine>
+		int get_rn(Engine & rng, int min, int max) {
+			if (min > max) {
+				std::swap(max, min);
+			}
+
+			auto diff = static_cast<unsigned int>(max - min);
+
+			return min + static_cast<int>(
+				std::uniform_int_distribution<typename Engine::result_type>(
+					0, diff
+				)(rng)
+			);
 		}
 
-		auto diff = static_cast<unsigned int>(max - min);
+	/**
+	 * SplitMix64, used to expand a single 64-bit seed into the 256 bits of
+	 * state that [[LD::Xoshiro256]] needs. See https://prng.di.unimi.it/
+	 *
+	 * @param state The state, which is advanced.
+	 * @return The next output
+	 */
+	inline uint64_t splitmix64(uint64_t & state) {
+		uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+
+		z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+		z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
 
-		return min + static_cast<int>(
-			std::uniform_int_distribution<std::mt19937::result_type>(0, diff)(
-				rng
-			)
-		);
+		return z ^ (z >> 31);
 	}
+
+	/**
+	 * xoshiro256** by David Blackman and Sebastiano Vigna. It's a lot smaller
+	 * and faster than [[std::mt19937]], and more importantly it can jump
+	 * ahead by 2^128 outputs in constant time, which is what
+	 * [[LD::RNGStreams]] uses to hand out non-overlapping streams.
+	 *
+	 * Satisfies UniformRandomBitGenerator, so it works with everything in
+	 * <random> as well as [[LD::get_rn]].
+	 */
+	class Xoshiro256 {
+		public:
+			using result_type = uint64_t;
+
+			explicit Xoshiro256(uint64_t seed = 0) {
+				this->seed(seed);
+			}
+
+			void seed(uint64_t seed) {
+				for (auto & word : s) {
+					word = splitmix64(seed);
+				}
+			}
+
+			static constexpr result_type min() {
+				return 0;
+			}
+
+			static constexpr result_type max() {
+				return std::numeric_limits<result_type>::max();
+			}
+
+			result_type operator()() {
+				const uint64_t result = rotl(s[1] * 5, 7) * 9;
+				const uint64_t t      = s[1] << 17;
+
+				s[2] ^= s[0];
+				s[3] ^= s[1];
+				s[1] ^= s[2];
+				s[0] ^= s[3];
+
+				s[2] ^= t;
+				s[3] = rotl(s[3], 45);
+
+				return result;
+			}
+
+			/**
+			 * Equivalent to 2^128 calls to operator(). Used to generate 2^128
+			 * non-overlapping subsequences.
+			 */
+			void jump() {
+				static constexpr uint64_t JUMP[] = {
+					0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL,
+					0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL
+				};
+
+				apply(JUMP);
+			}
+
+			/**
+			 * Equivalent to 2^192 calls to operator(). Used to generate 2^64
+			 * starting points, each of which can be [[jump]]ed 2^64 times.
+			 */
+			void long_jump() {
+				static constexpr uint64_t LONG_JUMP[] = {
+					0x76e15d3efefdcbbfULL, 0xc5004e441c522fb3ULL,
+					0x77710069854ee241ULL, 0x39109bb02acbe635ULL
+				};
+
+				apply(LONG_JUMP);
+			}
+
+			bool operator==(const Xoshiro256 & rhs) const {
+				return s[0] == rhs.s[0] && s[1] == rhs.s[1] &&
+				       s[2] == rhs.s[2] && s[3] == rhs.s[3];
+			}
+
+			bool operator!=(const Xoshiro256 & rhs) const {
+				return !(* this == rhs);
+			}
+
+		private:
+			uint64_t s[4] {};
+
+			static uint64_t rotl(uint64_t x, int k) {
+				return (x << k) | (x >> (64 - k));
+			}
+
+			void apply(const uint64_t (& poly)[4]) {
+				uint64_t t[4] {};
+
+				for (uint64_t word : poly) {
+					for (int b = 0; b < 64; b++) {
+						if (word & (uint64_t(1) << b)) {
+							t[0] ^= s[0];
+							t[1] ^= s[1];
+							t[2] ^= s[2];
+							t[3] ^= s[3];
+						}
+
+						(* this)();
+					}
+				}
+
+				s[0] = t[0];
+				s[1] = t[1];
+				s[2] = t[2];
+				s[3] = t[3];
+			}
+	};
+
+	/**
+	 * Derives any number of independent [[LD::Xoshiro256]] streams from one
+	 * master seed. Stream `i` is the master generator jumped ahead `i` times,
+	 * so streams never overlap and the same seed always produces the same
+	 * streams.
+	 *
+	 * To stay reproducible under a thread pool, index streams by something
+	 * deterministic (a worker or task index), never by the order threads
+	 * happen to start in:
+	 *
+	 *     LD::RNGStreams streams(1234, workers);
+	 *
+	 *     // in worker `n`
+	 *     auto & rng = streams.bind(n);
+	 *     LD::get_rn(rng, 1, 6);
+	 */
+	class RNGStreams {
+		public:
+			/**
+			 * @param seed The master seed.
+			 * @param count How many streams to precompute. Streams past
+			 * this are still available, they just cost one jump per index
+			 * past the end instead of a copy.
+			 */
+			explicit RNGStreams(uint64_t seed, size_t count = 0) {
+				Xoshiro256 rng(seed);
+
+				streams.reserve(count + 1);
+				streams.push_back(rng);
+
+				for (size_t i = 1; i < count; i++) {
+					rng.jump();
+					streams.push_back(rng);
+				}
+			}
+
+			/**
+			 * Gets stream `index`. This is const and doesn't touch shared
+			 * state, so any number of threads can call it at once.
+			 *
+			 * @param index
+			 * @return A copy of the stream's generator
+			 */
+			Xoshiro256 stream(size_t index) const {
+				if (index < streams.size()) {
+					return streams[index];
+				}
+
+				Xoshiro256 rng = streams.back();
+
+				for (size_t i = streams.size() - 1; i < index; i++) {
+					rng.jump();
+				}
+
+				return rng;
+			}
+
+			/**
+			 * Binds stream `index` to the calling thread, so that
+			 * [[LD::RNGStreams::local]] returns it from now on.
+			 *
+			 * @param index
+			 * @return The calling thread's generator
+			 */
+			Xoshiro256 & bind(size_t index) const {
+				return local() = stream(index);
+			}
+
+			/**
+			 * The calling thread's generator. Threads that never called
+			 * [[LD::RNGStreams::bind]] get one seeded from an
+			 * [[std::random_device]], which is fine for anything that
+			 * doesn't need to be reproducible.
+			 *
+			 * @return The generator
+			 */
+			static Xoshiro256 & local() {
+				thread_local Xoshiro256 rng(
+					(uint64_t(std::random_device()()) << 32) |
+					std::random_device()()
+				);
+
+				return rng;
+			}
+
+		private:
+			std::vector<Xoshiro256> streams;
+	};
 }
 
 #endif //__LD_PRNG_HPP
@@ -0,0 +1,406 @@
+#ifndef __LD_PROGRESS_HPP
+#define __LD_PROGRESS_HPP
+
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ld_config.hpp"
+#include "ld_ansi.hpp"
+#include "ld_output.hpp"
+#include "ld_tui.hpp"
+#include "ld_wstr.hpp"
+
+namespace LD {
+	/**
+	 * One bar in a [[LD::Progress]]. Workers only ever touch the counters,
+	 * which are relaxed atomics, so reporting progress from a hot loop
+	 * costs about as much as an increment.
+	 */
+	class ProgressBar {
+		public:
+			using clock = std::chrono::steady_clock;
+
+			ProgressBar(std::wstring label, uint64_t total)
+				: total(total), label(std::move(label)) {}
+
+			void add(uint64_t n = 1) {
+				done.fetch_add(n, std::memory_order_relaxed);
+			}
+
+			void set(uint64_t n) {
+				done.store(n, std::memory_order_relaxed);
+			}
+
+			/**
+			 * @param n 0 if the total isn't known, in which case only the
+			 * count and throughput are shown.
+			 */
+			void set_total(uint64_t n) {
+				total.store(n, std::memory_order_relaxed);
+			}
+
+			uint64_t get() const {
+				return done.load(std::memory_order_relaxed);
+			}
+
+			uint64_t get_total() const {
+				return total.load(std::memory_order_relaxed);
+			}
+
+		private:
+			friend class Progress;
+
+			// on their own cache line, so bars that are bumped from
+			// different threads don't slow each other down
+			alignas(64) std::atomic<uint64_t> done {0};
+			std::atomic<uint64_t>             total;
+
+			// only touched by the render thread
+			alignas(64) std::wstring label;
+			clock::time_point        started   = clock::now();
+			clock::time_point        last_time = started;
+			uint64_t                 last_done = 0;
+			double                   rate      = 0; // per second, smoothed
+	};
+
+	/**
+	 * A set of progress bars kept at the bottom of the terminal and redrawn
+	 * by a background thread at most `fps` times a second. Lines logged
+	 * through [[log]] are printed above the bars in the same write as the
+	 * next frame, so the two never tear.
+	 *
+	 * If stdout isn't a terminal, nothing is redrawn; logged lines are
+	 * printed once per frame, and the bars once at the end.
+	 *
+	 *     LD::Progress progress;
+	 *     LD::ProgressBar & files = progress.add_bar(L"files", paths.size());
+	 *
+	 *     for (auto & path : paths) {
+	 *         process(path);
+	 *         files.add();
+	 *     }
+	 */
+	class Progress {
+		public:
+			explicit Progress(double fps = 10)
+				: interval(std::chrono::duration_cast<ProgressBar::clock::duration>(
+					std::chrono::duration<double>(1 / (fps > 0 ? fps : 10))
+				)), interactive(isatty(1) != 0) {
+				if (interactive) {
+					raw.emplace();
+					TUI::RawMode::hide_cursor(true);
+				}
+
+				thread = std::thread([this] {
+					render_loop();
+				});
+			}
+
+			/**
+			 * Draws the bars one last time and leaves them on the screen.
+			 */
+			~Progress();
+
+			Progress(const Progress &) = delete;
+			Progress & operator=(const Progress &) = delete;
+
+			/**
+			 * The returned bar lives as long as this [[LD::Progress]].
+			 *
+			 * @param label
+			 * @param total
+			 * @return
+			 */
+			ProgressBar & add_bar(const std::wstring & label,
+			                      uint64_t total = 0) {
+				std::lock_guard<std::mutex> guard(lock);
+
+				bars.push_back(std::make_unique<ProgressBar>(label, total));
+
+				return * bars.back();
+			}
+
+			/**
+			 * Queues a line to be printed above the bars with the next
+			 * frame. Doesn't wait for the terminal.
+			 *
+			 * @param line Without the newline.
+			 */
+			void log(const std::wstring & line) {
+				std::lock_guard<std::mutex> guard(lock);
+
+				logs.push_back(line);
+			}
+
+			/**
+			 * Stops the render thread after one last frame. Called by the
+			 * destructor; calling it more than once is fine.
+			 */
+			void stop();
+
+		private:
+			ProgressBar::clock::duration interval;
+			bool                         interactive;
+
+			// brings the cursor back, even on a signal
+			std::optional<TUI::RawMode> raw;
+
+			std::mutex              lock;
+			std::condition_variable wake;
+			bool                    stopping = false;
+			std::thread             thread;
+
+			std::vector<std::unique_ptr<ProgressBar>> bars;
+			std::vector<std::wstring>                 logs;
+
+			/**
+			 * How many bar lines the last frame drew, so the next one
+			 * knows how far up to go.
+			 */
+			size_t drawn = 0;
+
+			void render_loop();
+
+			/**
+			 * Builds the whole frame (logs, then bars) into one string, so
+			 * it goes out in a single write. Called with [[lock]] held.
+			 *
+			 * @param draw_bars
+			 * @return
+			 */
+			std::wstring render(bool draw_bars);
+
+			static std::wstring format_count(double n);
+
+			static std::wstring format_time(double seconds);
+
+			/**
+			 * Something like `label [████░░░░]  42% 1.2k/3.0k 350/s ETA 0:05`,
+			 * cut to `width`.
+			 */
+			static std::wstring format_bar(ProgressBar & bar,
+			                               ProgressBar::clock::time_point now,
+			                               size_t width);
+	};
+}
+
+#if LD_DEFINITIONS
+namespace LD {
+	LD_DECL Progress::~Progress() {
+		stop();
+	}
+
+	LD_DECL void Progress::stop() {
+		{
+			std::lock_guard<std::mutex> guard(lock);
+
+			if (stopping) {
+				return;
+			}
+
+			stopping = true;
+		}
+
+		wake.notify_all();
+		thread.join();
+
+		if (interactive) {
+			TUI::RawMode::hide_cursor(false);
+			raw.reset();
+		}
+	}
+
+	LD_DECL void Progress::render_loop() {
+		std::unique_lock<std::mutex> guard(lock);
+		bool                         last = false;
+
+		while (!last) {
+			wake.wait_for(guard, interval);
+
+			last = stopping;
+
+			std::wstring frame = render(last || interactive);
+
+			// so workers can log while the terminal catches up
+			guard.unlock();
+
+			if (!frame.empty()) {
+				ofl(frame);
+			}
+
+			guard.lock();
+		}
+	}
+
+	LD_DECL std::wstring Progress::render(bool draw_bars) {
+		std::wstring frame;
+
+		if (!draw_bars && logs.empty()) {
+			return frame;
+		}
+
+		if (interactive && drawn > 0) {
+			frame.append(ANSI::c_up(drawn));
+		}
+
+		if (interactive) {
+			frame.append(L"\r");
+		}
+
+		for (const auto & line : logs) {
+			if (interactive) {
+				frame.append(ANSI::erase_line(ANSI::ELINE));
+			}
+
+			frame.append(line);
+			frame.append(L"\n");
+		}
+
+		logs.clear();
+		drawn = 0;
+
+		if (draw_bars) {
+			size_t width = TUI::terminal_size().first;
+			auto   now   = ProgressBar::clock::now();
+
+			for (auto & bar : bars) {
+				if (interactive) {
+					frame.append(ANSI::erase_line(ANSI::ELINE));
+				}
+
+				frame.append(format_bar(* bar, now, width));
+				frame.append(L"\n");
+				drawn++;
+			}
+		}
+
+		if (interactive) {
+			frame.append(ANSI::erase_screen(ANSI::ESCREENFROMC));
+		} else {
+			drawn = 0;
+		}
+
+		return frame;
+	}
+
+	LD_DECL std::wstring Progress::format_count(double n) {
+		static constexpr const char * UNITS[] = {"", "k", "M", "G", "T"};
+
+		size_t unit = 0;
+
+		while (n >= 1000 && unit + 1 < std::size(UNITS)) {
+			n /= 1000;
+			unit++;
+		}
+
+		char buf[32];
+
+		std::snprintf(buf, sizeof(buf), unit == 0 ? "%.0f%s" : "%.1f%s",
+		              n, UNITS[unit]);
+
+		return s2wstr(buf);
+	}
+
+	LD_DECL std::wstring Progress::format_time(double seconds) {
+		auto total = static_cast<unsigned long>(seconds + 0.5);
+		char buf[32];
+
+		if (total >= 3600) {
+			std::snprintf(buf, sizeof(buf), "%lu:%02lu:%02lu",
+			              total / 3600, total / 60 % 60, total % 60);
+		} else {
+			std::snprintf(buf, sizeof(buf), "%lu:%02lu", total / 60,
+			              total % 60);
+		}
+
+		return s2wstr(buf);
+	}
+
+	LD_DECL std::wstring Progress::format_bar(ProgressBar & bar,
+	                                          ProgressBar::clock::time_point now,
+	                                          size_t width) {
+		uint64_t done  = bar.get();
+		uint64_t total = bar.get_total();
+
+		double elapsed = std::chrono::duration<double>(
+			now - bar.last_time
+		).count();
+
+		if (elapsed > 0 && done >= bar.last_done) {
+			double rate = (done - bar.last_done) / elapsed;
+
+			// smoothed, so the ETA doesn't jump around every frame
+			bar.rate = bar.last_done == 0 && bar.rate == 0
+			           ? rate : bar.rate * 0.7 + rate * 0.3;
+
+			bar.last_time = now;
+			bar.last_done = done;
+		}
+
+		std::wstring stats;
+
+		if (total > 0) {
+			char percent[8];
+
+			std::snprintf(percent, sizeof(percent), "%3u%%",
+			              static_cast<unsigned>(
+				              done >= total ? 100 : done * 100 / total
+			              ));
+
+			stats.append(s2wstr(percent) + L" " + format_count(done) +
+			             L"/" + format_count(total));
+		} else {
+			stats.append(format_count(done));
+		}
+
+		stats.append(L" " + format_count(bar.rate) + L"/s");
+
+		if (total > 0 && done < total && bar.rate > 0) {
+			stats.append(L" ETA " + format_time((total - done) / bar.rate));
+		} else if (total > 0 && done >= total) {
+			stats.append(L" in " + format_time(std::chrono::duration<double>(
+				now - bar.started
+			).count()));
+		}
+
+		std::wstring line = bar.label + L" ";
+
+		// whatever's left over goes to the bar itself
+		size_t used = line.size() + stats.size() + 3;
+
+		if (total > 0 && width > used + 10) {
+			size_t inner  = width - used - 1;
+			size_t filled = done >= total
+			                ? inner : static_cast<size_t>(
+				                static_cast<double>(done) / total * inner
+			                );
+
+			line.append(L"[");
+			line.append(filled, L'█');
+			line.append(inner - filled, L'░');
+			line.append(L"] ");
+		}
+
+		line.append(stats);
+
+		if (line.size() >= width) {
+			line.resize(width > 0 ? width - 1 : 0);
+		}
+
+		return line;
+	}
+}
+#endif
+
+#endif //__LD_PROGRESS_HPP
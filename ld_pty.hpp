@@ -0,0 +1,492 @@
+#ifndef __LD_PTY_HPP
+#define __LD_PTY_HPP
+
+#include <poll.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <termios.h>
+#include <unistd.h>
+
+#if defined(__APPLE__)
+	#include <util.h>
+#else
+	#include <pty.h>
+#endif
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <deque>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace LD {
+	/**
+	 * Tools for driving a TUI through a pseudo-terminal, mainly to measure
+	 * how long it takes from a key arriving to the screen being updated.
+	 * Anything using this has to link with -lutil for [[forkpty]], which is
+	 * why it isn't included by main.hpp.
+	 */
+	namespace PTY {
+		/**
+		 * @return The value of a hex digit, or -1 if it isn't one.
+		 */
+		inline int hex_digit(char ch) {
+			if (ch >= '0' && ch <= '9') {
+				return ch - '0';
+			} else if (ch >= 'a' && ch <= 'f') {
+				return ch - 'a' + 10;
+			} else if (ch >= 'A' && ch <= 'F') {
+				return ch - 'A' + 10;
+			}
+
+			return -1;
+		}
+
+		/**
+		 * Turns a keystroke script into the bytes for each keystroke. There's
+		 * one keystroke per line, and these escapes are understood: \e, \n,
+		 * \r, \t, \\ and \xHH. Empty lines are skipped. Throws
+		 * [[std::runtime_error]] if a \x isn't followed by two hex digits.
+		 *
+		 * For example, "\e[A" is the up arrow and "q" is just q.
+		 *
+		 * @param text
+		 * @return
+		 */
+		inline std::vector<std::string> parse_script(const std::string & text) {
+			std::vector<std::string> keys;
+			std::string              key;
+
+			for (size_t i = 0; i <= text.size(); i++) {
+				if (i == text.size() || text[i] == '\n') {
+					if (!key.empty()) {
+						keys.push_back(key);
+						key.clear();
+					}
+
+					continue;
+				}
+
+				if (text[i] != '\\' || i + 1 == text.size()) {
+					key.push_back(text[i]);
+
+					continue;
+				}
+
+				switch (text[++i]) {
+					case 'e':
+						key.push_back('\033');
+
+						break;
+					case 'n':
+						key.push_back('\n');
+
+						break;
+					case 'r':
+						key.push_back('\r');
+
+						break;
+					case 't':
+						key.push_back('\t');
+
+						break;
+					case 'x': {
+						int high = i + 2 < text.size() ? hex_digit(text[i + 1])
+						                               : -1;
+						int low  = high >= 0 ? hex_digit(text[i + 2]) : -1;
+
+						if (low < 0) {
+							throw std::runtime_error(
+								"bad \\x escape in script at offset " +
+								std::to_string(i - 1)
+							);
+						}
+
+						key.push_back(static_cast<char>(high << 4 | low));
+						i += 2;
+
+						break;
+					}
+					default:
+						key.push_back(text[i]);
+				}
+			}
+
+			return keys;
+		}
+
+		/**
+		 * The results of [[LD::PTY::LatencyHarness::run]]. Latencies are in
+		 * microseconds.
+		 */
+		struct LatencyReport {
+			size_t keys      = 0; // keystrokes sent
+			size_t responses = 0; // keystrokes that got a response in time
+			double p50       = 0;
+			double p99       = 0;
+			double p999      = 0;
+			double max       = 0;
+			double keys_per_second  = 0;
+			double bytes_per_second = 0;
+			size_t bytes_out = 0;
+		};
+
+		/**
+		 * Runs a TUI in a child process attached to a new pseudo-terminal,
+		 * types a script into it, and times how long each keystroke takes to
+		 * produce output.
+		 *
+		 * A keystroke counts as answered when the app writes `frame_end`, or
+		 * anything at all if `frame_end` is empty, so an app that redraws in
+		 * several writes should end each frame with something recognizable
+		 * (like [[LD::ANSI::c_on]]). Responses are matched to keystrokes in
+		 * order, so the app should render once per key.
+		 *
+		 *     LD::PTY::LatencyHarness harness([] { my_tui(); });
+		 *
+		 *     auto report = harness.run(LD::PTY::parse_script("\\e[A\n\\e[B"),
+		 *                               1000);
+		 */
+		class LatencyHarness {
+			public:
+				using clock = std::chrono::steady_clock;
+
+				/**
+				 * Starts `app` in the child. Echo and line buffering are off
+				 * from the start, so keys sent before the app sets up its own
+				 * terminal mode don't come back as fake responses.
+				 *
+				 * Throws [[std::runtime_error]] if the child can't be
+				 * started.
+				 *
+				 * @param app Runs in the child, which exits when it returns.
+				 * @param cols
+				 * @param rows
+				 */
+				explicit LatencyHarness(const std::function<void()> & app,
+				                        unsigned short cols = 80,
+				                        unsigned short rows = 24) {
+					struct termios tio {};
+					struct winsize ws {};
+
+					if (tcgetattr(0, & tio) != 0) {
+						cfmakeraw(& tio);
+					}
+
+					tio.c_lflag &= ~(ICANON | ECHO);
+					tio.c_cc[VMIN]  = 1;
+					tio.c_cc[VTIME] = 0;
+
+					ws.ws_col = cols;
+					ws.ws_row = rows;
+
+					child = forkpty(& master, nullptr, & tio, & ws);
+
+					if (child < 0) {
+						throw std::runtime_error("forkpty failed");
+					}
+
+					if (child == 0) {
+						app();
+						std::fflush(stdout);
+						_exit(0);
+					}
+				}
+
+				~LatencyHarness() {
+					if (child > 0) {
+						kill(child, SIGTERM);
+						waitpid(child, nullptr, 0);
+					}
+
+					if (master >= 0) {
+						close(master);
+					}
+				}
+
+				LatencyHarness(const LatencyHarness &) = delete;
+				LatencyHarness & operator=(const LatencyHarness &) = delete;
+
+				/**
+				 * Waits until the app has been quiet for `quiet`, for example
+				 * after drawing its first screen. Everything it wrote is
+				 * thrown away.
+				 *
+				 * @param quiet
+				 */
+				void settle(clock::duration quiet =
+				            std::chrono::milliseconds(100)) {
+					while (read_output(to_ms(quiet)) > 0) {}
+
+					output.clear();
+				}
+
+				/**
+				 * Types `script` into the app, one keystroke every
+				 * 1/`keys_per_second` seconds. If `keys_per_second` is 0, each
+				 * keystroke is sent as soon as the previous one is answered,
+				 * which measures latency without any queueing.
+				 *
+				 * @param script The bytes for each keystroke, see
+				 * [[LD::PTY::parse_script]].
+				 * @param keys_per_second
+				 * @param frame_end What the app writes at the end of a frame.
+				 * @param timeout How long to wait for a response. A frame
+				 * that shows up after its keystroke timed out is thrown
+				 * away instead of being matched to the next keystroke, and
+				 * without a rate, the next keystroke waits for it (up to
+				 * another `timeout`).
+				 * @return
+				 */
+				LatencyReport run(const std::vector<std::string> & script,
+				                  double keys_per_second = 0,
+				                  const std::string & frame_end = "",
+				                  clock::duration timeout =
+				                  std::chrono::seconds(1)) {
+					settle();
+
+					LatencyReport              report;
+					std::vector<double>        latencies;
+					std::deque<clock::time_point> sent;
+
+					auto interval = keys_per_second > 0
+					                ? std::chrono::duration_cast<
+							clock::duration
+						>(std::chrono::duration<double>(1 / keys_per_second))
+					                : clock::duration::zero();
+
+					auto   start     = clock::now();
+					auto   next_send = start;
+					auto   last_seen = start;
+					auto   gave_up   = start;
+					size_t next_key  = 0;
+					size_t late      = 0; // timed out, frames maybe coming
+
+					while (true) {
+						auto now = clock::now();
+
+						bool can_send = next_key < script.size() &&
+						                (keys_per_second > 0
+						                 ? now >= next_send
+						                 : sent.empty() && late == 0);
+
+						if (can_send) {
+							write_all(script[next_key]);
+							sent.push_back(clock::now());
+							next_key++;
+							next_send += interval;
+
+							continue;
+						}
+
+						if (!sent.empty() && now - sent.front() >= timeout) {
+							// never answered in time. If its frame still
+							// shows up, it's thrown away instead of being
+							// credited to the next key
+							sent.pop_front();
+							late++;
+							gave_up = now;
+
+							continue;
+						}
+
+						if (late > 0 && now - gave_up >= timeout) {
+							// those frames are never coming
+							late = 0;
+
+							continue;
+						}
+
+						if (next_key == script.size() && sent.empty() &&
+						    late == 0) {
+							break;
+						}
+
+						int wait = to_ms(timeout);
+
+						if (!sent.empty()) {
+							wait = to_ms(sent.front() + timeout - now);
+						} else if (late > 0) {
+							wait = to_ms(gave_up + timeout - now);
+						}
+
+						if (keys_per_second > 0 && next_key < script.size()) {
+							wait = next_send > now ? to_ms(next_send - now) : 0;
+						}
+
+						ssize_t got = read_output(wait);
+
+						if (got < 0) {
+							break;
+						}
+
+						if (got == 0) {
+							continue;
+						}
+
+						now       = clock::now();
+						last_seen = now;
+
+						report.bytes_out += static_cast<size_t>(got);
+
+						size_t frames = count_frames(frame_end);
+
+						for (; frames > 0 && late > 0; frames--) {
+							late--;
+						}
+
+						for (; frames > 0 && !sent.empty(); frames--) {
+							latencies.push_back(
+								std::chrono::duration<double, std::micro>(
+									now - sent.front()
+								).count()
+							);
+
+							sent.pop_front();
+						}
+					}
+
+					double elapsed = std::chrono::duration<double>(
+						last_seen - start
+					).count();
+
+					report.keys      = next_key;
+					report.responses = latencies.size();
+
+					if (elapsed > 0) {
+						report.keys_per_second  = latencies.size() / elapsed;
+						report.bytes_per_second = report.bytes_out / elapsed;
+					}
+
+					if (!latencies.empty()) {
+						std::sort(latencies.begin(), latencies.end());
+
+						report.p50  = percentile(latencies, 0.5);
+						report.p99  = percentile(latencies, 0.99);
+						report.p999 = percentile(latencies, 0.999);
+						report.max  = latencies.back();
+					}
+
+					return report;
+				}
+
+			private:
+				pid_t child  = -1;
+				int   master = -1;
+
+				/**
+				 * Output that hasn't been matched against the frame marker
+				 * yet.
+				 */
+				std::string output;
+
+				/**
+				 * Rounded up, so waiting until a deadline doesn't turn into
+				 * polling with a 0 timeout for the last millisecond.
+				 */
+				static int to_ms(clock::duration duration) {
+					if (duration <= clock::duration::zero()) {
+						return 0;
+					}
+
+					return static_cast<int>(std::chrono::duration_cast<
+						std::chrono::milliseconds
+					>(duration + std::chrono::milliseconds(1) -
+					  clock::duration(1)).count());
+				}
+
+				static double percentile(const std::vector<double> & sorted,
+				                         double p) {
+					auto rank = static_cast<size_t>(p * sorted.size());
+
+					return sorted[rank < sorted.size() ? rank
+					                                   : sorted.size() - 1];
+				}
+
+				void write_all(const std::string & bytes) {
+					size_t done = 0;
+
+					while (done < bytes.size()) {
+						ssize_t wrote = write(master, bytes.data() + done,
+						                      bytes.size() - done);
+
+						if (wrote < 0 && errno == EINTR) {
+							continue;
+						} else if (wrote <= 0) {
+							return;
+						}
+
+						done += static_cast<size_t>(wrote);
+					}
+				}
+
+				/**
+				 * @return The number of bytes read, 0 on timeout, -1 once the
+				 * child has gone away
+				 */
+				ssize_t read_output(int timeout_ms) {
+					struct pollfd pfd {master, POLLIN, 0};
+
+					int ready = poll(& pfd, 1, timeout_ms);
+
+					if (ready == 0 || (ready < 0 && errno == EINTR)) {
+						return 0;
+					} else if (ready < 0) {
+						return -1;
+					}
+
+					char    buf[65536];
+					ssize_t got = read(master, buf, sizeof(buf));
+
+					if (got <= 0) {
+						return -1;
+					}
+
+					output.append(buf, static_cast<size_t>(got));
+
+					return got;
+				}
+
+				/**
+				 * Counts complete frames in [[output]] and drops everything
+				 * up to the end of the last one.
+				 */
+				size_t count_frames(const std::string & frame_end) {
+					if (frame_end.empty()) {
+						output.clear();
+
+						return 1;
+					}
+
+					size_t frames = 0;
+					size_t pos    = 0;
+					size_t found;
+
+					while ((found = output.find(frame_end, pos)) !=
+					       std::string::npos) {
+						frames++;
+						pos = found + frame_end.size();
+					}
+
+					// keep enough to catch a marker split across reads
+					size_t keep = frame_end.size() - 1;
+
+					if (pos > 0) {
+						output.erase(0, pos);
+					}
+
+					if (output.size() > keep) {
+						output.erase(0, output.size() - keep);
+					}
+
+					return frames;
+				}
+		};
+	}
+}
+
+#endif //__LD_PTY_HPP
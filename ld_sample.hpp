@@ -0,0 +1,377 @@
+#ifndef __LD_SAMPLE_HPP
+#define __LD_SAMPLE_HPP
+
+#include <cmath>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "ld_prng.hpp"
+
+namespace LD {
+	/**
+	 * Gets 64 random bits out of any engine. 64-bit engines like
+	 * [[LD::Xoshiro256]] are called once, 32-bit engines like
+	 * [[std::mt19937]] twice.
+	 *
+	 * @tparam Engine
+	 * @param rng
+	 * @return
+	 */
+	template <class Engine>
+		uint64_t next_u64(Engine & rng) {
+			constexpr auto min = Engine::min();
+			constexpr auto max = Engine::max();
+
+			if constexpr (min == 0 && max == UINT64_MAX) {
+				return rng();
+			} else if constexpr (min == 0 && max == UINT32_MAX) {
+				return (uint64_t(rng()) << 32) | uint64_t(rng());
+			} else {
+				return std::uniform_int_distribution<uint64_t>()(rng);
+			}
+		}
+
+	/**
+	 * Gets a random double in the open interval (0, 1), so it's always safe
+	 * to take the log of.
+	 *
+	 * @tparam Engine
+	 * @param rng
+	 * @return
+	 */
+	template <class Engine>
+		double next_open_unit(Engine & rng) {
+			return (static_cast<double>(next_u64(rng) >> 11) + 0.5) *
+			       (1.0 / 9007199254740992.0);
+		}
+
+	/**
+	 * Gets a random integer in [0, range) using Lemire's nearly divisionless
+	 * method (https://arxiv.org/abs/1805.10941): one multiply per draw, and
+	 * a division only in the rare case where the draw might be biased.
+	 *
+	 * Falls back to [[std::uniform_int_distribution]] for engines that don't
+	 * produce a full 32 or 64 bits.
+	 *
+	 * @tparam Engine
+	 * @param rng
+	 * @param range Must be greater than 0.
+	 * @return
+	 */
+	template <class Engine>
+		uint64_t get_bounded(Engine & rng, uint64_t range) {
+			constexpr auto min = Engine::min();
+			constexpr auto max = Engine::max();
+
+			// @formatter:off
+		#ifdef __SIZEOF_INT128__
+			if constexpr (min == 0 && max == UINT64_MAX) {
+				__uint128_t m = __uint128_t(rng()) * range;
+				auto        l = static_cast<uint64_t>(m);
+
+				if (l < range) {
+					uint64_t t = -range % range;
+
+					while (l < t) {
+						m = __uint128_t(rng()) * range;
+						l = static_cast<uint64_t>(m);
+					}
+				}
+
+				return static_cast<uint64_t>(m >> 64);
+			} else
+		#endif
+			if constexpr (min == 0 && max == UINT32_MAX) {
+				if (range <= UINT32_MAX) {
+					auto     r32 = static_cast<uint32_t>(range);
+					uint64_t m   = uint64_t(rng()) * r32;
+					auto     l   = static_cast<uint32_t>(m);
+
+					if (l < r32) {
+						uint32_t t = -r32 % r32;
+
+						while (l < t) {
+							m = uint64_t(rng()) * r32;
+							l = static_cast<uint32_t>(m);
+						}
+					}
+
+					return m >> 32;
+				}
+			}
+			// @formatter:on
+
+			return std::uniform_int_distribution<uint64_t>(0, range - 1)(rng);
+		}
+
+	/**
+	 * Shuffles [first, last) with Fisher-Yates.
+	 *
+	 * With a 64-bit engine, two swap targets are drawn from every random
+	 * word (Brackett-Rozinsky & Lemire, "Batched Ranged Random Integer
+	 * Generation"), which halves the number of engine calls compared to
+	 * [[std::shuffle]]. Other engines get one [[LD::get_bounded]] per swap.
+	 *
+	 * @tparam RandomIt
+	 * @tparam Engine
+	 * @param first
+	 * @param last
+	 * @param rng
+	 */
+	template <class RandomIt, class Engine>
+		void shuffle(RandomIt first, RandomIt last, Engine & rng) {
+			using std::swap;
+
+			auto n = static_cast<uint64_t>(std::distance(first, last));
+
+			if (n < 2) {
+				return;
+			}
+
+			// index of the element that is about to be placed
+			uint64_t i = n - 1;
+
+			// @formatter:off
+		#ifdef __SIZEOF_INT128__
+			if constexpr (Engine::min() == 0 && Engine::max() == UINT64_MAX) {
+				/*
+				 * (i + 1) * i has to fit in 64 bits, so arrays with more than
+				 * 2^32 elements do their first few swaps one at a time
+				 */
+				while (i >= UINT32_MAX) {
+					swap(first[i], first[get_bounded(rng, i + 1)]);
+					i--;
+				}
+
+				while (i >= 2) {
+					uint64_t b1    = i + 1;
+					uint64_t b2    = i;
+					uint64_t bound = b1 * b2;
+
+					__uint128_t x  = __uint128_t(rng()) * b1;
+					auto        r1 = static_cast<uint64_t>(x >> 64);
+					auto        l  = static_cast<uint64_t>(x);
+
+					x = __uint128_t(l) * b2;
+
+					auto r2 = static_cast<uint64_t>(x >> 64);
+					l = static_cast<uint64_t>(x);
+
+					if (l < bound) {
+						uint64_t t = -bound % bound;
+
+						while (l < t) {
+							x  = __uint128_t(rng()) * b1;
+							r1 = static_cast<uint64_t>(x >> 64);
+							l  = static_cast<uint64_t>(x);
+							x  = __uint128_t(l) * b2;
+							r2 = static_cast<uint64_t>(x >> 64);
+							l  = static_cast<uint64_t>(x);
+						}
+					}
+
+					swap(first[i], first[r1]);
+					swap(first[i - 1], first[r2]);
+					i -= 2;
+				}
+			}
+		#endif
+			// @formatter:on
+
+			for (; i > 0; i--) {
+				swap(first[i], first[get_bounded(rng, i + 1)]);
+			}
+		}
+
+	/**
+	 * Picks `k` elements uniformly at random from [first, last) in a single
+	 * pass, without knowing the length up front and without holding more
+	 * than `k` elements. Uses Li's Algorithm L, which skips over elements
+	 * that won't be picked instead of drawing a random number for each one.
+	 *
+	 * If there are fewer than `k` elements, all of them are returned.
+	 *
+	 * @tparam InputIt Only needs to be an input iterator.
+	 * @tparam Engine
+	 * @param first
+	 * @param last
+	 * @param k
+	 * @param rng
+	 * @return The sample, in no particular order
+	 */
+	template <class InputIt, class Engine>
+		std::vector<typename std::iterator_traits<InputIt>::value_type>
+		reservoir_sample(InputIt first, InputIt last, size_t k, Engine & rng) {
+			std::vector<typename std::iterator_traits<InputIt>::value_type>
+				reservoir;
+
+			if (k == 0) {
+				return reservoir;
+			}
+
+			reservoir.reserve(k);
+
+			for (; first != last && reservoir.size() < k; ++first) {
+				reservoir.push_back(* first);
+			}
+
+			double w = std::exp(std::log(next_open_unit(rng)) / k);
+
+			while (first != last) {
+				double skip = std::floor(
+					std::log(next_open_unit(rng)) / std::log1p(-w)
+				);
+
+				for (double s = 0; s < skip && first != last; s++) {
+					++first;
+				}
+
+				if (first == last) {
+					break;
+				}
+
+				reservoir[get_bounded(rng, k)] = * first;
+				++first;
+
+				w *= std::exp(std::log(next_open_unit(rng)) / k);
+			}
+
+			return reservoir;
+		}
+
+	/**
+	 * A Walker/Vose alias table. Takes O(n) to build from a list of weights
+	 * and then picks an index with probability proportional to its weight in
+	 * O(1), instead of scanning the weights every time.
+	 *
+	 *     LD::AliasTable table(std::vector<double> {1, 2, 7});
+	 *     size_t picked = table(rng); // 2 about 70% of the time
+	 */
+	class AliasTable {
+		public:
+			AliasTable() = default;
+
+			/**
+			 * Throws [[std::runtime_error]] if there are no weights, or if
+			 * any of them are negative or they add up to 0.
+			 *
+			 * @tparam Weights Any range of numbers.
+			 * @param weights
+			 */
+			template <class Weights>
+				explicit AliasTable(const Weights & weights) {
+					std::vector<double> scaled;
+					double              total = 0;
+
+					for (const auto & weight : weights) {
+						auto w = static_cast<double>(weight);
+
+						if (!(w >= 0)) {
+							throw std::runtime_error("negative weight");
+						}
+
+						scaled.push_back(w);
+						total += w;
+					}
+
+					if (scaled.empty() || !(total > 0)) {
+						throw std::runtime_error("weights add up to 0");
+					}
+
+					size_t n = scaled.size();
+
+					threshold.resize(n);
+					alias.resize(n);
+
+					std::vector<size_t> small, large;
+
+					for (size_t i = 0; i < n; i++) {
+						scaled[i] = scaled[i] * n / total;
+
+						(scaled[i] < 1 ? small : large).push_back(i);
+					}
+
+					while (!small.empty() && !large.empty()) {
+						size_t s = small.back();
+						size_t l = large.back();
+
+						small.pop_back();
+
+						threshold[s] = to_threshold(scaled[s]);
+						alias[s]     = l;
+
+						scaled[l] = (scaled[l] + scaled[s]) - 1;
+
+						if (scaled[l] < 1) {
+							large.pop_back();
+							small.push_back(l);
+						}
+					}
+
+					// whatever is left over is 1 up to rounding error. These
+					// are their own alias, so drawing UINT64_MAX (the one
+					// value the threshold doesn't keep) still picks them
+					for (size_t i : large) {
+						threshold[i] = UINT64_MAX;
+						alias[i]     = i;
+					}
+
+					for (size_t i : small) {
+						threshold[i] = UINT64_MAX;
+						alias[i]     = i;
+					}
+				}
+
+			/**
+			 * Picks a random index.
+			 *
+			 * @tparam Engine
+			 * @param rng
+			 * @return
+			 */
+			template <class Engine>
+				size_t operator()(Engine & rng) const {
+					auto i = static_cast<size_t>(
+						get_bounded(rng, threshold.size())
+					);
+
+					return next_u64(rng) < threshold[i] ? i : alias[i];
+				}
+
+			size_t size() const {
+				return threshold.size();
+			}
+
+		private:
+			/**
+			 * The probability of keeping column `i` instead of taking its
+			 * alias, scaled to the full range of a uint64_t so it can be
+			 * compared directly against a random word: the column is kept if
+			 * the word is below it, so a threshold of 0 is never kept.
+			 */
+			std::vector<uint64_t> threshold;
+			std::vector<size_t>   alias;
+
+			/**
+			 * Only called for columns below 1. The largest double below 1
+			 * is 1 - 2^-53, so the result always fits and never reaches
+			 * UINT64_MAX, which is only used for full columns.
+			 */
+			static uint64_t to_threshold(double probability) {
+				if (probability >= 1) {
+					return UINT64_MAX;
+				}
+
+				return static_cast<uint64_t>(
+					probability * 18446744073709551616.0
+				);
+			}
+	};
+}
+
+#endif //__LD_SAMPLE_HPP
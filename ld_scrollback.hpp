@@ -0,0 +1,530 @@
+#ifndef __LD_SCROLLBACK_HPP
+#define __LD_SCROLLBACK_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include "ld_config.hpp"
+#include "ld_ansi.hpp"
+#include "ld_output.hpp"
+#include "ld_sgr.hpp"
+#include "ld_trace.hpp"
+#include "ld_tui.hpp"
+#include "ld_wstr.hpp"
+
+namespace LD {
+	/**
+	 * A bounded log of lines, for scrolling back through output that's long
+	 * gone off the screen. The text is kept as UTF-8 in one fixed-size ring
+	 * of bytes, and where each line starts is kept in a fixed-size ring of
+	 * offsets, so memory never grows past what's asked for up front; once
+	 * either ring is full, the oldest lines are dropped to make room.
+	 *
+	 * Lines are numbered from the first one ever pushed, so a line keeps
+	 * its number as older ones are dropped. Getting any line by number is
+	 * two array lookups, however many lines there are.
+	 *
+	 * Not thread-safe.
+	 *
+	 *     LD::Scrollback history;
+	 *
+	 *     for (...) {
+	 *         LD::lognl(message);
+	 *         history.push(message);
+	 *     }
+	 *
+	 *     LD::view_scrollback(history);
+	 */
+	class Scrollback {
+		public:
+			static constexpr uint64_t npos = UINT64_MAX;
+
+			/**
+			 * @param bytes How many bytes of text to keep.
+			 * @param lines How many lines to keep. 0 means one for every 32
+			 * bytes.
+			 */
+			explicit Scrollback(size_t bytes = 16 * 1024 * 1024,
+			                    size_t lines = 0)
+				: capacity(bytes > 0 ? bytes : 1),
+				  max_lines(lines > 0 ? lines : std::max<size_t>(bytes / 32, 1)),
+				  ring(new char[capacity]),
+				  starts(new uint64_t[max_lines]) {}
+
+			Scrollback(const Scrollback &) = delete;
+			Scrollback & operator=(const Scrollback &) = delete;
+
+			/**
+			 * Adds a line, or several if there are newlines in it. A line
+			 * longer than the whole ring is cut off.
+			 *
+			 * @param text UTF-8, without the final newline.
+			 */
+			void push(std::string_view text);
+
+			/**
+			 * @param text Without the final newline.
+			 */
+			void push(std::wstring_view text);
+
+			/**
+			 * @return The number of the oldest line still kept.
+			 */
+			uint64_t first() const {
+				return first_line;
+			}
+
+			/**
+			 * @return One past the number of the newest line, which is also
+			 * how many lines have ever been pushed.
+			 */
+			uint64_t end() const {
+				return end_line;
+			}
+
+			/**
+			 * @return How many lines are kept right now.
+			 */
+			size_t size() const {
+				return static_cast<size_t>(end_line - first_line);
+			}
+
+			bool empty() const {
+				return first_line == end_line;
+			}
+
+			/**
+			 * Gets a line without copying it, unless it wraps around the end
+			 * of the ring, in which case it's copied into `buffer`. Either
+			 * way it's only good until the next [[push]].
+			 *
+			 * @param n Between [[first]] and [[end]].
+			 * @param buffer
+			 * @return The line, as UTF-8.
+			 */
+			std::string_view line(uint64_t n, std::string & buffer) const;
+
+			/**
+			 * @param n
+			 * @return A copy of the line.
+			 */
+			std::string line(uint64_t n) const {
+				std::string buffer;
+
+				return std::string(line(n, buffer));
+			}
+
+			/**
+			 * Finds the next line that contains `needle`.
+			 *
+			 * @param needle UTF-8.
+			 * @param from The first line to look at.
+			 * @param forward Whether to look at newer lines or older ones.
+			 * @return The line's number, or [[npos]]
+			 */
+			uint64_t find(std::string_view needle, uint64_t from,
+			              bool forward = true) const;
+
+			void clear() {
+				first_line = end_line;
+			}
+
+		private:
+			size_t capacity;
+			size_t max_lines;
+
+			std::unique_ptr<char[]>     ring;
+			std::unique_ptr<uint64_t[]> starts;
+
+			uint64_t head       = 0; // bytes ever written
+			uint64_t first_line = 0;
+			uint64_t end_line   = 0;
+
+			std::string scratch;
+
+			void push_line(std::string_view text);
+	};
+
+	/**
+	 * A pager over a [[LD::Scrollback]], like `less`. Only the lines on the
+	 * screen are ever looked at, so it's just as fast over ten million lines
+	 * as over ten.
+	 *
+	 * Up/Down (or j/k) scroll by a line, PgUp/PgDn (or b/space) by a
+	 * screen, and Home/End (or g/G) go to the oldest and newest lines. `/`
+	 * searches towards newer lines and `?` towards older ones, then n and N
+	 * repeat the search. q or ESC quits. Starts at the newest lines.
+	 *
+	 * @param log
+	 */
+	LD_DECL void view_scrollback(const Scrollback & log);
+}
+
+#if LD_DEFINITIONS
+namespace LD {
+	namespace _scrollback {
+		/**
+		 * Appends `text` cut to `width`, with control characters (which
+		 * would mess up the screen) turned into spaces.
+		 */
+		inline void put_line(std::wstring & out, std::wstring & wide,
+		                     std::string_view text, size_t width) {
+			wide.clear();
+
+			try {
+				s2wstr(text, wide);
+			} catch (const std::range_error &) {
+				wide.clear();
+
+				for (char ch : text) {
+					wide.push_back(static_cast<unsigned char>(ch) < 0x80
+					               ? static_cast<wchar_t>(ch) : L'?');
+				}
+			}
+
+			if (wide.size() > width) {
+				wide.resize(width);
+			}
+
+			for (wchar_t & ch : wide) {
+				if (ch < L' ' || ch == 0x7f) {
+					ch = L' ';
+				}
+			}
+
+			out.append(wide);
+		}
+
+		/**
+		 * Reads a search query on the status line.
+		 *
+		 * @return false if it was cancelled
+		 */
+		inline bool prompt(wchar_t prefix, std::wstring & query,
+		                   size_t rows) {
+			using TUI::Keys;
+
+			query.clear();
+
+			while (true) {
+				ofl(ANSI::c_mov(0, rows) + std::wstring(1, prefix) + query +
+				    ANSI::erase_line(ANSI::ELINEFROMC));
+
+				Keys::Key key = TUI::getch();
+
+				switch (Keys::base(key)) {
+					case Keys::CR:
+					case Keys::LF:
+						return !query.empty();
+					case Keys::NUL:
+					case Keys::ESC:
+						return false;
+					case Keys::BS:
+					case Keys::DELETE:
+						if (!query.empty()) {
+							query.pop_back();
+						}
+
+						break;
+					case Keys::PASTE:
+						query.append(s2wstr(
+							TUI::KeyDecoder::shared().take_paste()
+						));
+
+						break;
+					default:
+						if (Keys::mods(key) == 0 && key >= Keys::SPACE &&
+						    key < Keys::DELETE) {
+							query.append(1, static_cast<wchar_t>(key));
+						}
+				}
+			}
+		}
+	}
+
+	LD_DECL void Scrollback::push(std::string_view text) {
+		size_t last = 0;
+
+		while (true) {
+			size_t end = text.find('\n', last);
+
+			if (end == std::string_view::npos) {
+				push_line(text.substr(last));
+
+				return;
+			}
+
+			push_line(text.substr(last, end - last));
+			last = end + 1;
+		}
+	}
+
+	LD_DECL void Scrollback::push(std::wstring_view text) {
+		scratch.clear();
+		w2str(text, scratch);
+
+		// push_line never looks at scratch, so this is safe
+		push(std::string_view(scratch));
+	}
+
+	LD_DECL std::string_view Scrollback::line(uint64_t n,
+	                                          std::string & buffer) const {
+		if (n < first_line || n >= end_line) {
+			throw std::out_of_range("line not in scrollback");
+		}
+
+		uint64_t start = starts[n % max_lines];
+		uint64_t stop  = n + 1 == end_line ? head
+		                                   : starts[(n + 1) % max_lines];
+
+		size_t at  = static_cast<size_t>(start % capacity);
+		size_t len = static_cast<size_t>(stop - start);
+
+		if (at + len <= capacity) {
+			return std::string_view(ring.get() + at, len);
+		}
+
+		size_t tail = capacity - at;
+
+		buffer.assign(ring.get() + at, tail);
+		buffer.append(ring.get(), len - tail);
+
+		return buffer;
+	}
+
+	LD_DECL uint64_t Scrollback::find(std::string_view needle, uint64_t from,
+	                                  bool forward) const {
+		LD_TRACE_SCOPE("LD::Scrollback::find");
+
+		if (empty()) {
+			return npos;
+		}
+
+		std::string buffer;
+
+		if (forward) {
+			for (uint64_t n = std::max(from, first_line); n < end_line;
+			     n++) {
+				if (line(n, buffer).find(needle) !=
+				    std::string_view::npos) {
+					return n;
+				}
+			}
+		} else if (from >= first_line) {
+			for (uint64_t n = std::min(from, end_line - 1) + 1;
+			     n-- > first_line;) {
+				if (line(n, buffer).find(needle) !=
+				    std::string_view::npos) {
+					return n;
+				}
+			}
+		}
+
+		return npos;
+	}
+
+	LD_DECL void Scrollback::push_line(std::string_view text) {
+		if (text.size() > capacity) {
+			size_t cut = capacity;
+
+			// don't leave half a character at the end
+			while (cut > 0 &&
+			       (static_cast<unsigned char>(text[cut]) & 0xc0) ==
+			       0x80) {
+				cut--;
+			}
+
+			text = text.substr(0, cut);
+		}
+
+		if (end_line - first_line == max_lines) {
+			first_line++;
+		}
+
+		while (first_line < end_line &&
+		       head + text.size() - starts[first_line % max_lines] >
+		       capacity) {
+			first_line++;
+		}
+
+		starts[end_line % max_lines] = head;
+		end_line++;
+
+		size_t at   = static_cast<size_t>(head % capacity);
+		size_t tail = std::min(text.size(), capacity - at);
+
+		std::memcpy(ring.get() + at, text.data(), tail);
+		std::memcpy(ring.get(), text.data() + tail, text.size() - tail);
+
+		head += text.size();
+	}
+
+	LD_DECL void view_scrollback(const Scrollback & log) {
+		using TUI::Keys;
+
+		TUI::RawMode raw;
+
+		// undone by the raw mode session too, if it's cut short
+		TUI::RawMode::alt_screen(true);
+		TUI::RawMode::hide_cursor(true);
+
+		// the first line on the screen, past the end to show the newest
+		uint64_t top = Scrollback::npos;
+
+		std::wstring query;
+		std::string  needle;
+		bool         forward = true;
+		std::wstring message;
+
+		std::string  buffer;
+		std::wstring wide;
+		std::wstring frame;
+
+		while (true) {
+			auto   size = TUI::terminal_size();
+			size_t rows = size.second > 1 ? size.second - 1 : 1;
+
+			// as far down as it goes, while still filling the screen
+			uint64_t bottom = log.end() > log.first() + rows
+			                  ? log.end() - rows : log.first();
+
+			top = std::clamp(top, log.first(), bottom);
+
+			LD_TRACE_SCOPE("LD::view_scrollback frame");
+
+			frame = ANSI::c_home();
+
+			for (size_t row = 0; row < rows; row++) {
+				if (row > 0) {
+					frame.append(L"\r\n");
+				}
+
+				uint64_t n = top + row;
+
+				if (n < log.end()) {
+					_scrollback::put_line(frame, wide, log.line(n, buffer),
+					                      size.first);
+				}
+
+				frame.append(ANSI::erase_line(ANSI::ELINEFROMC));
+			}
+
+			std::wstring status = message;
+
+			if (status.empty()) {
+				status = log.empty()
+				         ? L"(empty)"
+				         : L"lines " + wtostring(top - log.first() + 1) + L"-" +
+				           wtostring(std::min<uint64_t>(top + rows, log.end()) -
+				                     log.first()) +
+				           L" of " + wtostring(log.size());
+			}
+
+			if (status.size() > size.first) {
+				status.resize(size.first);
+			}
+
+			frame.append(L"\r\n");
+			frame.append(SGR::SGR({SGR::REVERSE}));
+			frame.append(status);
+			frame.append(SGR::reset());
+			frame.append(ANSI::erase_line(ANSI::ELINEFROMC));
+
+			ofl(frame);
+
+			message.clear();
+
+			Keys::Key key  = TUI::getch();
+			bool      find = false;
+			bool      back = false;
+
+			switch (Keys::base(key)) {
+				case Keys::UP:
+				case Keys::k:
+					top = top > log.first() ? top - 1 : top;
+
+					break;
+				case Keys::DOWN:
+				case Keys::j:
+				case Keys::CR:
+				case Keys::LF:
+					top++;
+
+					break;
+				case Keys::PAGE_UP:
+				case Keys::b:
+					top = top > log.first() + rows ? top - rows : log.first();
+
+					break;
+				case Keys::PAGE_DOWN:
+				case Keys::SPACE:
+					top += rows;
+
+					break;
+				case Keys::HOME:
+				case Keys::g:
+					top = log.first();
+
+					break;
+				case Keys::END:
+				case Keys::G:
+					top = Scrollback::npos;
+
+					break;
+				case Keys::SLASH:
+				case Keys::QUESTION_MARK:
+					forward = key == Keys::SLASH;
+
+					if (_scrollback::prompt(forward ? L'/' : L'?', query,
+					                        rows)) {
+						needle.clear();
+						w2str(query, needle);
+						find = true;
+					}
+
+					break;
+				case Keys::n:
+					find = !needle.empty();
+
+					break;
+				case Keys::N:
+					find = !needle.empty();
+					back = true;
+
+					break;
+				case Keys::NUL:
+				case Keys::ESC:
+				case Keys::q:
+					TUI::RawMode::hide_cursor(false);
+					TUI::RawMode::alt_screen(false);
+
+					return;
+				default:
+					break;
+			}
+
+			if (find) {
+				bool     ahead = forward != back;
+				uint64_t found = ahead
+				                 ? log.find(needle, top + 1, true)
+				                 : (top > log.first()
+				                    ? log.find(needle, top - 1, false)
+				                    : Scrollback::npos);
+
+				if (found == Scrollback::npos) {
+					message = L"not found: " + query;
+				} else {
+					top = found;
+				}
+			}
+		}
+	}
+}
+#endif
+
+#endif //__LD_SCROLLBACK_HPP
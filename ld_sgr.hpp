@@ -1,78 +1,92 @@
 #ifndef __LD_SGR_HPP
 #define __LD_SGR_HPP
 
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <initializer_list>
+#include <memory_resource>
 #include <string>
+#include <vector>
 
+#include "ld_config.hpp"
+#include "ld_trace.hpp"
 #include "ld_wstr.hpp"
 
 namespace LD {
 	namespace SGR {
-		size_t RESET             = 0; // clear all attributes
-		size_t BOLD              = 1; // bold
-		size_t DIM               = 2; // dim
-		size_t ITALIC            = 3; // italic
-		size_t UNDERLINE         = 4; // underline
-		size_t SLOW_BLINK        = 5; // less than 150 blinks/s
-		size_t RAPID_BLINK       = 6; // more than 150 blinks/s
-		size_t REVERSE           = 7; // reverse video
-		size_t CONCEAL           = 8; // hidden
-		size_t STRIKETHROUGH     = 9;
-		size_t FRAKTUR           = 20;
-		size_t BOLD_OFF          = 21; // or doubly underlined
-		size_t REGULAR           = 22; // not bold or faint
-		size_t NORMAL            = 23; // not italic, not fraktur
-		size_t NO_UNDERLINE      = 24;
-		size_t NO_BLINK          = 25;
-		size_t NO_REVERSE        = 27;
-		size_t NO_CONCEAL        = 28;
-		size_t NO_STRIKETHROUGH  = 29;
-		size_t BLACK             = 30;
-		size_t RED               = 31;
-		size_t GREEN             = 32;
-		size_t YELLOW            = 33;
-		size_t BLUE              = 34;
-		size_t MAGENTA           = 35;
-		size_t CYAN              = 35;
-		size_t WHITE             = 37;
-		size_t SET_FG            = 38; // useless?
-		size_t DEFAULT_FG        = 39;
-		size_t BG_BLACK          = 40;
-		size_t BG_RED            = 41;
-		size_t BG_GREEN          = 42;
-		size_t BG_YELLOW         = 43;
-		size_t BG_BLUE           = 44;
-		size_t BG_MAGENTA        = 45;
-		size_t BG_CYAN           = 45;
-		size_t BG_WHITE          = 47;
-		size_t SET_BG            = 48; // useless?
-		size_t DEFAULT_BG        = 49;
-		size_t FRAMED            = 51; // nonfunctional?
-		size_t ENCIRCLED         = 51; // nonfunctional?
-		size_t OVERLINED         = 53;
-		size_t NO_BORDER         = 54; // not framed or encircled
-		size_t NO_OVERLINE       = 55;
-		size_t BRIGHT_BLACK      = 90;
-		size_t BRIGHT_RED        = 91;
-		size_t BRIGHT_GREEN      = 92;
-		size_t BRIGHT_YELLOW     = 93;
-		size_t BRIGHT_BLUE       = 94;
-		size_t BRIGHT_MAGENTA    = 95;
-		size_t BRIGHT_CYAN       = 95;
-		size_t BRIGHT_WHITE      = 97;
-		size_t BG_BRIGHT_BLACK   = 100;
-		size_t BG_BRIGHT_RED     = 101;
-		size_t BG_BRIGHT_GREEN   = 102;
-		size_t BG_BRIGHT_YELLOW  = 103;
-		size_t BG_BRIGHT_BLUE    = 104;
-		size_t BG_BRIGHT_MAGENTA = 105;
-		size_t BG_BRIGHT_CYAN    = 105;
-		size_t BG_BRIGHT_WHITE   = 107;
-
-		std::wstring CSI() { return L"\033["; }
-
-		std::wstring reset() { return CSI() + L"m"; }
-
-		std::wstring SGR(const std::vector<size_t> codes) {
+		inline constexpr size_t RESET             = 0; // clear all attributes
+		inline constexpr size_t BOLD              = 1; // bold
+		inline constexpr size_t DIM               = 2; // dim
+		inline constexpr size_t ITALIC            = 3; // italic
+		inline constexpr size_t UNDERLINE         = 4; // underline
+		inline constexpr size_t SLOW_BLINK        = 5; // less than 150 blinks/s
+		inline constexpr size_t RAPID_BLINK       = 6; // more than 150 blinks/s
+		inline constexpr size_t REVERSE           = 7; // reverse video
+		inline constexpr size_t CONCEAL           = 8; // hidden
+		inline constexpr size_t STRIKETHROUGH     = 9;
+		inline constexpr size_t FRAKTUR           = 20;
+		inline constexpr size_t BOLD_OFF          = 21; // or doubly underlined
+		inline constexpr size_t REGULAR           = 22; // not bold or faint
+		inline constexpr size_t NORMAL            = 23; // not italic, not fraktur
+		inline constexpr size_t NO_UNDERLINE      = 24;
+		inline constexpr size_t NO_BLINK          = 25;
+		inline constexpr size_t NO_REVERSE        = 27;
+		inline constexpr size_t NO_CONCEAL        = 28;
+		inline constexpr size_t NO_STRIKETHROUGH  = 29;
+		inline constexpr size_t BLACK             = 30;
+		inline constexpr size_t RED               = 31;
+		inline constexpr size_t GREEN             = 32;
+		inline constexpr size_t YELLOW            = 33;
+		inline constexpr size_t BLUE              = 34;
+		inline constexpr size_t MAGENTA           = 35;
+		inline constexpr size_t CYAN              = 36;
+		inline constexpr size_t WHITE             = 37;
+		inline constexpr size_t SET_FG            = 38; // then 5;n or 2;r;g;b, see [[fg]]
+		inline constexpr size_t DEFAULT_FG        = 39;
+		inline constexpr size_t BG_BLACK          = 40;
+		inline constexpr size_t BG_RED            = 41;
+		inline constexpr size_t BG_GREEN          = 42;
+		inline constexpr size_t BG_YELLOW         = 43;
+		inline constexpr size_t BG_BLUE           = 44;
+		inline constexpr size_t BG_MAGENTA        = 45;
+		inline constexpr size_t BG_CYAN           = 46;
+		inline constexpr size_t BG_WHITE          = 47;
+		inline constexpr size_t SET_BG            = 48; // then 5;n or 2;r;g;b, see [[bg]]
+		inline constexpr size_t DEFAULT_BG        = 49;
+		inline constexpr size_t FRAMED            = 51; // nonfunctional?
+		inline constexpr size_t ENCIRCLED         = 52; // nonfunctional?
+		inline constexpr size_t OVERLINED         = 53;
+		inline constexpr size_t NO_BORDER         = 54; // not framed or encircled
+		inline constexpr size_t NO_OVERLINE       = 55;
+		inline constexpr size_t BRIGHT_BLACK      = 90;
+		inline constexpr size_t BRIGHT_RED        = 91;
+		inline constexpr size_t BRIGHT_GREEN      = 92;
+		inline constexpr size_t BRIGHT_YELLOW     = 93;
+		inline constexpr size_t BRIGHT_BLUE       = 94;
+		inline constexpr size_t BRIGHT_MAGENTA    = 95;
+		inline constexpr size_t BRIGHT_CYAN       = 96;
+		inline constexpr size_t BRIGHT_WHITE      = 97;
+		inline constexpr size_t BG_BRIGHT_BLACK   = 100;
+		inline constexpr size_t BG_BRIGHT_RED     = 101;
+		inline constexpr size_t BG_BRIGHT_GREEN   = 102;
+		inline constexpr size_t BG_BRIGHT_YELLOW  = 103;
+		inline constexpr size_t BG_BRIGHT_BLUE    = 104;
+		inline constexpr size_t BG_BRIGHT_MAGENTA = 105;
+		inline constexpr size_t BG_BRIGHT_CYAN    = 106;
+		inline constexpr size_t BG_BRIGHT_WHITE   = 107;
+
+		inline std::wstring CSI() { return L"\033["; }
+
+		inline std::wstring reset() {
+			LD_STAT(ESCAPES, 1);
+
+			return CSI() + L"m";
+		}
+
+		inline std::wstring SGR(const std::vector<size_t> codes) {
+			LD_STAT(ESCAPES, 1);
+
 			std::wstring built = CSI();
 
 			for (const size_t & code : codes) {
@@ -84,7 +98,340 @@ namespace LD {
 
 			return built;
 		}
+
+		/**
+		 * [[CSI]], allocated from `mem` instead of the heap.
+		 */
+		inline std::pmr::wstring CSI(std::pmr::memory_resource & mem) {
+			return std::pmr::wstring(L"\033[", & mem);
+		}
+
+		/**
+		 * [[reset]], allocated from `mem` instead of the heap.
+		 */
+		inline std::pmr::wstring reset(std::pmr::memory_resource & mem) {
+			LD_STAT(ESCAPES, 1);
+
+			return std::pmr::wstring(L"\033[m", & mem);
+		}
+
+		/**
+		 * [[SGR]], allocated from `mem` instead of the heap. The codes are
+		 * an initializer list, so nothing else is allocated either.
+		 *
+		 * @param mem
+		 * @param codes
+		 * @return
+		 */
+		inline std::pmr::wstring SGR(std::pmr::memory_resource & mem,
+		                             std::initializer_list<size_t> codes) {
+			LD_STAT(ESCAPES, 1);
+
+			std::pmr::wstring built(& mem);
+
+			built.reserve(2 + codes.size() * 4);
+			built.append(L"\033[");
+
+			for (size_t code : codes) {
+				append_wnum(built, code);
+				built.append(1, L';');
+			}
+
+			if (codes.size() == 0) {
+				built.append(1, L'm');
+			} else {
+				built[built.size() - 1] = L'm';
+			}
+
+			return built;
+		}
+
+		/**
+		 * How many colours the terminal can show. See [[color_mode]].
+		 */
+		enum ColorMode {
+			COLORS_16,
+			COLORS_256,
+			TRUECOLOR
+		};
+
+		struct RGB {
+			uint8_t r;
+			uint8_t g;
+			uint8_t b;
+		};
+
+		/**
+		 * Guesses the colour mode from the environment: `COLORTERM` set
+		 * to `truecolor` or `24bit` means [[TRUECOLOR]], a `TERM` with
+		 * `256color` in it means [[COLORS_256]], and anything else gets
+		 * [[COLORS_16]].
+		 *
+		 * @return
+		 */
+		inline ColorMode detect_color_mode() {
+			const char * colorterm = std::getenv("COLORTERM");
+			const char * term      = std::getenv("TERM");
+
+			if (colorterm != nullptr &&
+			    (std::strcmp(colorterm, "truecolor") == 0 ||
+			     std::strcmp(colorterm, "24bit") == 0)) {
+				return TRUECOLOR;
+			}
+
+			if (term != nullptr && std::strstr(term, "256color") != nullptr) {
+				return COLORS_256;
+			}
+
+			return COLORS_16;
+		}
+
+		/**
+		 * The mode [[fg]] and [[bg]] emit colours for. Starts out as
+		 * [[detect_color_mode]]; assign to it to override that, before
+		 * any threads start drawing.
+		 *
+		 * @return
+		 */
+		inline ColorMode & color_mode() {
+			static ColorMode mode = detect_color_mode();
+
+			return mode;
+		}
+
+		/**
+		 * @param color
+		 * @return The nearest colour in the 256-colour palette, leaving
+		 * out the first 16, which every terminal draws differently.
+		 */
+		LD_DECL uint8_t nearest_256(RGB color);
+
+		/**
+		 * @param color
+		 * @return The nearest of the 16 basic colours, 0-7 normal and 8-15
+		 * bright.
+		 */
+		LD_DECL uint8_t nearest_16(RGB color);
+
+		namespace _sgr {
+			/**
+			 * Appends a whole SGR sequence that sets the foreground or
+			 * background to `color` in `mode`.
+			 */
+			template <class Str>
+				void put_color(Str & out, RGB color, bool background,
+				               ColorMode mode) {
+					LD_STAT(ESCAPES, 1);
+
+					out.append(L"\033[");
+
+					if (mode == TRUECOLOR) {
+						out.append(background ? L"48;2;" : L"38;2;");
+						append_wnum(out, color.r);
+						out.append(1, L';');
+						append_wnum(out, color.g);
+						out.append(1, L';');
+						append_wnum(out, color.b);
+					} else if (mode == COLORS_256) {
+						out.append(background ? L"48;5;" : L"38;5;");
+						append_wnum(out, nearest_256(color));
+					} else {
+						size_t i = nearest_16(color);
+
+						append_wnum(out, i < 8 ? (background ? BG_BLACK : BLACK) + i
+						                       : (background ? BG_BRIGHT_BLACK
+						                                     : BRIGHT_BLACK) + i - 8);
+					}
+
+					out.append(1, L'm');
+				}
+		}
+
+		/**
+		 * Sets the foreground to `color`: exactly if the terminal does
+		 * truecolor, otherwise the nearest colour it has. Downsampling is
+		 * one table lookup, so this is fine to call for every cell.
+		 *
+		 * @param color
+		 * @param mode
+		 * @return
+		 */
+		inline std::wstring fg(RGB color, ColorMode mode = color_mode()) {
+			std::wstring built;
+
+			built.reserve(20);
+			_sgr::put_color(built, color, false, mode);
+
+			return built;
+		}
+
+		/**
+		 * [[fg]], but for the background.
+		 */
+		inline std::wstring bg(RGB color, ColorMode mode = color_mode()) {
+			std::wstring built;
+
+			built.reserve(20);
+			_sgr::put_color(built, color, true, mode);
+
+			return built;
+		}
+
+		/**
+		 * [[fg]], allocated from `mem` instead of the heap.
+		 */
+		inline std::pmr::wstring fg(std::pmr::memory_resource & mem,
+		                            RGB color, ColorMode mode = color_mode()) {
+			std::pmr::wstring built(& mem);
+
+			built.reserve(20);
+			_sgr::put_color(built, color, false, mode);
+
+			return built;
+		}
+
+		/**
+		 * [[bg]], allocated from `mem` instead of the heap.
+		 */
+		inline std::pmr::wstring bg(std::pmr::memory_resource & mem,
+		                            RGB color, ColorMode mode = color_mode()) {
+			std::pmr::wstring built(& mem);
+
+			built.reserve(20);
+			_sgr::put_color(built, color, true, mode);
+
+			return built;
+		}
+	}
+}
+
+#if LD_DEFINITIONS
+namespace LD {
+	namespace SGR {
+		namespace _sgr {
+			/**
+			 * The colours of the 16-colour palette, as xterm draws them by
+			 * default. Terminals differ, but these are close enough to pick
+			 * the nearest one.
+			 */
+			inline constexpr RGB BASIC[16] = {
+				{0, 0, 0}, {205, 0, 0}, {0, 205, 0}, {205, 205, 0},
+				{0, 0, 238}, {205, 0, 205}, {0, 205, 205}, {229, 229, 229},
+				{127, 127, 127}, {255, 0, 0}, {0, 255, 0}, {255, 255, 0},
+				{92, 92, 255}, {255, 0, 255}, {0, 255, 255}, {255, 255, 255}
+			};
+
+			/**
+			 * The colour of entry `i` in the 256-colour palette, for
+			 * 16 and up: a 6x6x6 cube, then 24 greys.
+			 */
+			inline RGB extended(size_t i) {
+				static constexpr uint8_t LEVELS[6] = {0, 95, 135, 175, 215,
+				                                      255};
+
+				if (i >= 232) {
+					auto grey = static_cast<uint8_t>(8 + (i - 232) * 10);
+
+					return RGB {grey, grey, grey};
+				}
+
+				i -= 16;
+
+				return RGB {LEVELS[i / 36], LEVELS[i / 6 % 6], LEVELS[i % 6]};
+			}
+
+			/**
+			 * A cheap perceptual distance ("redmean"), which weighs the
+			 * channels the way the eye does depending on how red the
+			 * colours are.
+			 */
+			inline uint32_t distance(RGB a, RGB b) {
+				int mean = (a.r + b.r) / 2;
+				int dr   = a.r - b.r;
+				int dg   = a.g - b.g;
+				int db   = a.b - b.b;
+
+				return static_cast<uint32_t>(
+					((512 + mean) * dr * dr >> 8) + 4 * dg * dg +
+					((767 - mean) * db * db >> 8)
+				);
+			}
+
+			/**
+			 * The nearest palette entry for every colour, with each channel
+			 * cut down to 5 bits, so looking a colour up is one load. Built
+			 * the first time a colour has to be downsampled.
+			 */
+			struct Lut {
+				static constexpr size_t SIZE = 32 * 32 * 32;
+
+				uint8_t to_16[SIZE];
+				uint8_t to_256[SIZE];
+
+				Lut() {
+					LD_TRACE_SCOPE("LD::SGR::_sgr::Lut");
+
+					RGB palette[256];
+
+					for (size_t i = 0; i < 256; i++) {
+						palette[i] = i < 16 ? BASIC[i] : extended(i);
+					}
+
+					for (size_t i = 0; i < SIZE; i++) {
+						// the middle of the bucket
+						RGB color {
+							static_cast<uint8_t>((i >> 10) << 3 | 4),
+							static_cast<uint8_t>((i >> 5 & 31) << 3 | 4),
+							static_cast<uint8_t>((i & 31) << 3 | 4)
+						};
+
+						to_16[i]  = nearest(color, palette, 0, 16);
+						// 0-15 look different on every terminal, so 256
+						// colour mode sticks to the cube and the greys
+						to_256[i] = nearest(color, palette, 16, 256);
+					}
+				}
+
+				static uint8_t nearest(RGB color, const RGB * palette,
+				                       size_t from, size_t to) {
+					size_t   best      = from;
+					uint32_t best_dist = UINT32_MAX;
+
+					for (size_t i = from; i < to; i++) {
+						uint32_t dist = distance(color, palette[i]);
+
+						if (dist < best_dist) {
+							best      = i;
+							best_dist = dist;
+						}
+					}
+
+					return static_cast<uint8_t>(best);
+				}
+
+				static size_t index(RGB color) {
+					return static_cast<size_t>(color.r >> 3) << 10 |
+					       static_cast<size_t>(color.g >> 3) << 5 |
+					       static_cast<size_t>(color.b >> 3);
+				}
+			};
+
+			inline const Lut & lut() {
+				static const Lut table;
+
+				return table;
+			}
+		}
+
+		LD_DECL uint8_t nearest_256(RGB color) {
+			return _sgr::lut().to_256[_sgr::Lut::index(color)];
+		}
+
+		LD_DECL uint8_t nearest_16(RGB color) {
+			return _sgr::lut().to_16[_sgr::Lut::index(color)];
+		}
 	}
 }
+#endif
 
 #endif //__LD_SGR_HPP
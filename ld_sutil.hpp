@@ -2,10 +2,15 @@
 #define __LD_SUTIL_HPP
 
 #include <istream>
+#include <memory_resource>
 #include <string>
+#include <string_view>
 #include <sstream>
 #include <vector>
 
+#include "ld_config.hpp"
+#include "ld_trace.hpp"
+
 namespace LD {
 	/**
 	 * Consumes the next word from a [[std::wstringstream]], accounting for extra
@@ -14,7 +19,7 @@ namespace LD {
 	 * @param stream The stream to consume the word from.
 	 * @param output The string to put the output inside.
 	 */
-	void consume_word(
+	inline void consume_word(
 		std::basic_istream<wchar_t> & stream, std::wstring & output,
 		std::wstring * trailingwhite = nullptr
 	) {
@@ -57,7 +62,7 @@ namespace LD {
 	 * @param str
 	 * @return
 	 */
-	std::wstring remove_leading_ws(const std::wstring & str) {
+	inline std::wstring remove_leading_ws(const std::wstring & str) {
 		unsigned long pos = 0;
 
 		while (pos < str.length() - 1 && std::isspace(str[pos]) != 0) {
@@ -73,7 +78,7 @@ namespace LD {
 	 * @param str
 	 * @return
 	 */
-	std::wstring remove_trailing_ws(const std::wstring & str) {
+	inline std::wstring remove_trailing_ws(const std::wstring & str) {
 		unsigned long len = str.length();
 
 		while (len > 0 && std::isspace(str[len - 1]) != 0) {
@@ -89,7 +94,7 @@ namespace LD {
 	 * @param str
 	 * @return
 	 */
-	std::wstring remove_surrounding_ws(const std::wstring & str) {
+	inline std::wstring remove_surrounding_ws(const std::wstring & str) {
 		return remove_leading_ws(remove_trailing_ws(str));
 	}
 
@@ -100,7 +105,7 @@ namespace LD {
 	 * @param lpad If this is true, pad from the left instead of the right.
 	 * @return The padded string, guaranteed to be `width` characters long
 	 */
-	std::wstring pad(const std::wstring & src, unsigned long width,
+	inline std::wstring pad(const std::wstring & src, unsigned long width,
 	                 wchar_t character = ' ', bool lpad = false) {
 		if (src.size() > width) {
 			return src.substr(0, width);
@@ -125,19 +130,13 @@ namespace LD {
 		std::vector<std::basic_string<Char>> split_str(
 			const std::basic_string<Char> & str, const Char & ch) {
 			std::vector<std::basic_string<Char>> strs;
-			std::basic_stringstream<Char>        ss;
 
 			size_t last = 0;
-			size_t len  = 0;
-			Char   peeked;
-			while ((peeked = ss.peek()) != std::char_traits<Char>::eof()) {
-				if (peeked == ch) {
-					strs.push_back(str.substr(last, len));
-					last += len + 1;
-					len = 0;
-				} else {
-					len++;
-				}
+			size_t found;
+
+			while ((found = str.find(ch, last)) != str.npos) {
+				strs.push_back(str.substr(last, found - last));
+				last = found + 1;
 			}
 
 			strs.push_back(str.substr(last, str.size() - last));
@@ -166,7 +165,7 @@ namespace LD {
 			return str;
 		}
 
-	std::wstring pad_multiline(const std::wstring & src, unsigned long width,
+	inline std::wstring pad_multiline(const std::wstring & src, unsigned long width,
 	                           wchar_t character = ' ', bool lpad = false) {
 		std::vector<std::wstring> lines = split_str(src, L'\n');
 
@@ -177,7 +176,137 @@ namespace LD {
 		return join_str(lines, L'\n');
 	}
 
-	std::pair<size_t, size_t> get_dimensions(const std::wstring & str) {
+	namespace _sutil {
+		/**
+		 * Appends `src` to `out`, padded or cut to `width`, like [[pad]].
+		 */
+		template <class Str>
+			void pad_into(Str & out, std::wstring_view src,
+			              unsigned long width, wchar_t character, bool lpad) {
+				if (src.size() >= width) {
+					out.append(src.substr(0, width));
+				} else if (lpad) {
+					out.append(width - src.size(), character);
+					out.append(src);
+				} else {
+					out.append(src);
+					out.append(width - src.size(), character);
+				}
+			}
+	}
+
+	/**
+	 * [[pad]], allocated from `mem` (like a [[LD::FrameArena]]) instead of
+	 * the heap.
+	 *
+	 * @param mem
+	 * @param src
+	 * @param width
+	 * @param character
+	 * @param lpad
+	 * @return
+	 */
+	inline std::pmr::wstring pad(std::pmr::memory_resource & mem,
+	                             std::wstring_view src, unsigned long width,
+	                             wchar_t character = ' ', bool lpad = false) {
+		std::pmr::wstring built(& mem);
+
+		built.reserve(width);
+		_sutil::pad_into(built, src, width, character, lpad);
+
+		return built;
+	}
+
+	/**
+	 * [[split_str]], allocated from `mem` instead of the heap.
+	 */
+	template <class Char, class Traits, class Alloc>
+		std::pmr::vector<std::pmr::basic_string<Char>> split_str(
+			std::pmr::memory_resource & mem,
+			const std::basic_string<Char, Traits, Alloc> & str,
+			const Char & ch) {
+			std::pmr::vector<std::pmr::basic_string<Char>> strs(& mem);
+
+			size_t last = 0;
+			size_t found;
+
+			while (true) {
+				found = str.find(ch, last);
+
+				if (found == str.npos) {
+					found = str.size();
+				}
+
+				strs.emplace_back(str.data() + last, found - last);
+
+				if (found == str.size()) {
+					return strs;
+				}
+
+				last = found + 1;
+			}
+		}
+
+	/**
+	 * [[join_str]], allocated from `mem` instead of the heap.
+	 */
+	template <class Char>
+		std::pmr::basic_string<Char> join_str(
+			std::pmr::memory_resource & mem,
+			const std::pmr::vector<std::pmr::basic_string<Char>> & strs,
+			const Char & ch) {
+			std::pmr::basic_string<Char> str(& mem);
+			size_t                       len = 0;
+
+			for (const auto & part : strs) {
+				len += part.size() + 1;
+			}
+
+			str.reserve(len);
+
+			for (size_t i = 0; i < strs.size(); i++) {
+				str.append(strs[i]);
+
+				if (i < strs.size() - 1) {
+					str.append(1, ch);
+				}
+			}
+
+			return str;
+		}
+
+	/**
+	 * [[pad_multiline]], allocated from `mem` instead of the heap. Each line
+	 * is padded straight into the result, without splitting first.
+	 */
+	inline std::pmr::wstring pad_multiline(std::pmr::memory_resource & mem,
+	                                       std::wstring_view src,
+	                                       unsigned long width,
+	                                       wchar_t character = ' ',
+	                                       bool lpad = false) {
+		std::pmr::wstring built(& mem);
+		size_t            last = 0;
+
+		while (true) {
+			size_t found = src.find(L'\n', last);
+
+			if (found == std::wstring_view::npos) {
+				found = src.size();
+			}
+
+			_sutil::pad_into(built, src.substr(last, found - last), width,
+			                 character, lpad);
+
+			if (found == src.size()) {
+				return built;
+			}
+
+			built.append(1, L'\n');
+			last = found + 1;
+		}
+	}
+
+	inline std::pair<size_t, size_t> get_dimensions(const std::wstring & str) {
 		std::wstringstream        ss(str);
 		std::vector<std::wstring> lines = split_str(str, L'\n');
 		size_t                    width = 0;
@@ -191,14 +320,36 @@ namespace LD {
 		return std::make_pair(width, lines.size());
 	}
 
-	std::pair<
+	LD_DECL std::pair<
+		std::pair<
+			std::vector<size_t>,
+			std::vector<size_t>
+		>,
+		std::vector<std::vector<std::wstring>>
+	> tabulate(
+		const std::vector<std::vector<std::wstring>> & tbl, bool lpad = false);
+
+	LD_DECL std::wstring render_tabulated(const std::pair<
+		std::pair<
+			std::vector<size_t>,
+			std::vector<size_t>
+		>,
+		std::vector<std::vector<std::wstring>>
+	> & data);
+}
+
+#if LD_DEFINITIONS
+namespace LD {
+	LD_DECL std::pair<
 		std::pair<
 			std::vector<size_t>,
 			std::vector<size_t>
 		>,
 		std::vector<std::vector<std::wstring>>
 	> tabulate(
-		const std::vector<std::vector<std::wstring>> & tbl, bool lpad = false) {
+		const std::vector<std::vector<std::wstring>> & tbl, bool lpad) {
+		LD_TRACE_SCOPE("LD::tabulate");
+
 		if (tbl.empty()) {
 			return {};
 		}
@@ -212,6 +363,8 @@ namespace LD {
 		cols.resize(width);
 		rows.resize(height);
 
+		LD_STAT(CELLS_RENDERED, width * height);
+
 		std::vector<std::vector<std::wstring>> padded;
 
 		padded.resize(height);
@@ -246,13 +399,15 @@ namespace LD {
 		return std::make_pair(std::make_pair(rows, cols), padded);
 	}
 
-	std::wstring render_tabulated(const std::pair<
+	LD_DECL std::wstring render_tabulated(const std::pair<
 		std::pair<
 			std::vector<size_t>,
 			std::vector<size_t>
 		>,
 		std::vector<std::vector<std::wstring>>
 	> & data) {
+		LD_TRACE_SCOPE("LD::render_tabulated");
+
 		std::wstring result;
 
 		auto rowcols = data.first;
@@ -297,5 +452,6 @@ namespace LD {
 		return result.substr(0, result.size() - 1);
 	}
 }
+#endif
 
 #endif //__LD_SUTIL_HPP
@@ -0,0 +1,103 @@
+#ifndef __LD_TRACE_HPP
+#define __LD_TRACE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// @formatter:off
+#ifdef LD_USE_TRACE
+	#define LD_TRACE_CAT2(A, B) A##B
+	#define LD_TRACE_CAT(A, B) LD_TRACE_CAT2(A, B)
+
+	/**
+	 * Adds `N` to the counter [[LD::Trace::COUNTER]].
+	 */
+	#define LD_STAT(COUNTER, N) LD::Trace::add(LD::Trace::COUNTER, N)
+
+	/**
+	 * Times the rest of the enclosing scope as a span called `NAME`, which
+	 * has to be a string literal.
+	 */
+	#define LD_TRACE_SCOPE(NAME) \
+		LD::Trace::Span LD_TRACE_CAT(_ld_span_, __LINE__)(NAME)
+#else
+	#define LD_STAT(COUNTER, N) ((void) 0)
+	#define LD_TRACE_SCOPE(NAME) ((void) 0)
+#endif
+// @formatter:on
+
+namespace LD {
+	/**
+	 * Optional instrumentation for the library's hot paths. The library only
+	 * records anything if it's compiled with LD_USE_TRACE defined; without
+	 * it, [[LD_STAT]] and [[LD_TRACE_SCOPE]] expand to nothing, and
+	 * everything here just reports zeros.
+	 *
+	 * Spans and the exporters ([[LD::Trace::Span]], [[snapshot]],
+	 * [[reset]] and [[write_chrome_trace]]) are in ld_trace_spans.hpp,
+	 * which is only included with LD_USE_TRACE, so headers that just use
+	 * the macros don't pull in its dependencies. Without LD_USE_TRACE they
+	 * don't exist at all, so guard any use of them the same way:
+	 *
+	 *     {
+	 *         LD_TRACE_SCOPE("redraw");
+	 *         LD::ofl(frame);
+	 *     }
+	 *
+	 *     #ifdef LD_USE_TRACE
+	 *         LD::Trace::write_chrome_trace("trace.json");
+	 *     #endif
+	 */
+	namespace Trace {
+		enum Counter : size_t {
+			CHARS_WRITTEN,  // characters passed to [[LD::o]]
+			WRITES,         // calls to [[LD::o]]
+			FLUSHES,        // calls to [[LD::fl]]
+			ESCAPES,        // sequences built by [[LD::ANSI]] and [[LD::SGR]]
+			KEYS_DECODED,   // keys decoded by [[LD::TUI::KeyDecoder]]
+			INPUT_READS,    // read() calls on stdin by [[LD::TUI::InputReader]]
+			CONVERSIONS,    // [[LD::s2wstr]] and [[LD::w2str]] calls
+			CELLS_RENDERED, // table cells laid out by [[LD::tabulate]]
+			COUNTER_COUNT
+		};
+
+		inline const char * counter_name(Counter counter) {
+			static constexpr const char * NAMES[] = {
+				"chars_written", "writes", "flushes", "escapes",
+				"keys_decoded", "input_reads", "conversions", "cells_rendered"
+			};
+
+			return counter < COUNTER_COUNT ? NAMES[counter] : "unknown";
+		}
+
+		inline std::atomic<uint64_t> * counters() {
+			static std::atomic<uint64_t> values[COUNTER_COUNT] {};
+
+			return values;
+		}
+
+		/**
+		 * Relaxed, since these are only statistics; nothing synchronizes
+		 * through them.
+		 *
+		 * @param counter
+		 * @param n
+		 */
+		inline void add(Counter counter, uint64_t n = 1) {
+			counters()[counter].fetch_add(n, std::memory_order_relaxed);
+		}
+
+		inline uint64_t get(Counter counter) {
+			return counters()[counter].load(std::memory_order_relaxed);
+		}
+	}
+}
+
+// @formatter:off
+#ifdef LD_USE_TRACE
+	#include "ld_trace_spans.hpp"
+#endif
+// @formatter:on
+
+#endif //__LD_TRACE_HPP
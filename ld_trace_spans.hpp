@@ -0,0 +1,288 @@
+#ifndef __LD_TRACE_SPANS_HPP
+#define __LD_TRACE_SPANS_HPP
+
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "ld_trace.hpp"
+
+namespace LD {
+	namespace Trace {
+		using clock = std::chrono::steady_clock;
+
+		/**
+		 * Summary of every span with one name.
+		 */
+		struct Timing {
+			uint64_t count    = 0;
+			uint64_t total_ns = 0;
+			uint64_t max_ns   = 0;
+		};
+
+		struct Snapshot {
+			uint64_t counters[COUNTER_COUNT] {};
+
+			std::unordered_map<std::string, Timing> timings;
+		};
+
+		namespace _trace {
+			struct Event {
+				const char * name;
+				uint64_t     start_ns;
+				uint64_t     duration_ns;
+			};
+
+			/**
+			 * One per thread, so recording a span only ever takes a lock
+			 * that nobody else wants, except while exporting.
+			 */
+			struct Buffer {
+				std::mutex lock;
+				size_t     tid;
+
+				std::vector<Event>                       events;
+				std::unordered_map<const char *, Timing> timings;
+			};
+
+			/**
+			 * Spans past this many per thread are still summarized, but
+			 * left out of the trace.
+			 */
+			constexpr size_t MAX_EVENTS = 1 << 20;
+
+			struct Registry {
+				std::mutex                           lock;
+				std::vector<std::shared_ptr<Buffer>> buffers;
+				clock::time_point                    epoch = clock::now();
+			};
+
+			inline Registry & registry() {
+				static Registry reg;
+
+				return reg;
+			}
+
+			inline Buffer & local() {
+				thread_local std::shared_ptr<Buffer> buffer = [] {
+					auto        made = std::make_shared<Buffer>();
+					Registry  & reg  = registry();
+					std::lock_guard<std::mutex> guard(reg.lock);
+
+					made->tid = reg.buffers.size() + 1;
+					reg.buffers.push_back(made);
+
+					return made;
+				}();
+
+				return * buffer;
+			}
+
+			inline uint64_t since_epoch(clock::time_point time) {
+				if (time <= registry().epoch) {
+					return 0;
+				}
+
+				return static_cast<uint64_t>(
+					std::chrono::duration_cast<std::chrono::nanoseconds>(
+						time - registry().epoch
+					).count()
+				);
+			}
+
+			inline void write_escaped(std::ostream & out, const char * str) {
+				for (; * str != '\0'; str++) {
+					if (* str == '"' || * str == '\\') {
+						out << '\\';
+					}
+
+					out << * str;
+				}
+			}
+		}
+
+		/**
+		 * Records how long it's alive as a span called `name`. Use
+		 * [[LD_TRACE_SCOPE]] rather than this directly, so that it compiles
+		 * out.
+		 */
+		class Span {
+			public:
+				/**
+				 * @param name Has to outlive every export, so use a string
+				 * literal.
+				 */
+				explicit Span(const char * name) : name(name) {
+					// so the epoch is never later than the first span
+					_trace::registry();
+
+					start = clock::now();
+				}
+
+				~Span() {
+					auto end = clock::now();
+
+					uint64_t start_ns    = _trace::since_epoch(start);
+					uint64_t duration_ns = _trace::since_epoch(end) - start_ns;
+
+					_trace::Buffer & buffer = _trace::local();
+					std::lock_guard<std::mutex> guard(buffer.lock);
+
+					Timing & timing = buffer.timings[name];
+
+					timing.count++;
+					timing.total_ns += duration_ns;
+
+					if (duration_ns > timing.max_ns) {
+						timing.max_ns = duration_ns;
+					}
+
+					if (buffer.events.size() < _trace::MAX_EVENTS) {
+						buffer.events.push_back({name, start_ns, duration_ns});
+					}
+				}
+
+				Span(const Span &) = delete;
+				Span & operator=(const Span &) = delete;
+
+			private:
+				const char        * name;
+				clock::time_point start;
+		};
+
+		/**
+		 * @return Every counter, and a summary of the spans on all threads,
+		 * as of now.
+		 */
+		inline Snapshot snapshot() {
+			Snapshot snap;
+
+			for (size_t i = 0; i < COUNTER_COUNT; i++) {
+				snap.counters[i] = get(static_cast<Counter>(i));
+			}
+
+			_trace::Registry & reg = _trace::registry();
+			std::lock_guard<std::mutex> guard(reg.lock);
+
+			for (auto & buffer : reg.buffers) {
+				std::lock_guard<std::mutex> buffer_guard(buffer->lock);
+
+				for (auto & entry : buffer->timings) {
+					Timing & timing = snap.timings[entry.first];
+
+					timing.count    += entry.second.count;
+					timing.total_ns += entry.second.total_ns;
+
+					if (entry.second.max_ns > timing.max_ns) {
+						timing.max_ns = entry.second.max_ns;
+					}
+				}
+			}
+
+			return snap;
+		}
+
+		/**
+		 * Zeroes every counter and forgets every span recorded so far.
+		 */
+		inline void reset() {
+			for (size_t i = 0; i < COUNTER_COUNT; i++) {
+				counters()[i].store(0, std::memory_order_relaxed);
+			}
+
+			_trace::Registry & reg = _trace::registry();
+			std::lock_guard<std::mutex> guard(reg.lock);
+
+			for (auto & buffer : reg.buffers) {
+				std::lock_guard<std::mutex> buffer_guard(buffer->lock);
+
+				buffer->events.clear();
+				buffer->timings.clear();
+			}
+		}
+
+		/**
+		 * Writes every span as a complete ("X") event, followed by the
+		 * counters as one counter ("C") event, in the Chrome trace event
+		 * format. Open it in chrome://tracing or https://ui.perfetto.dev.
+		 *
+		 * @param out
+		 */
+		inline void write_chrome_trace(std::ostream & out) {
+			long pid = static_cast<long>(getpid());
+
+			out << "{\"traceEvents\":[";
+
+			bool first = true;
+
+			{
+				_trace::Registry & reg = _trace::registry();
+				std::lock_guard<std::mutex> guard(reg.lock);
+
+				for (auto & buffer : reg.buffers) {
+					std::lock_guard<std::mutex> buffer_guard(buffer->lock);
+
+					for (const _trace::Event & event : buffer->events) {
+						char times[64];
+
+						std::snprintf(times, sizeof(times),
+						              "\"ts\":%.3f,\"dur\":%.3f",
+						              event.start_ns / 1000.0,
+						              event.duration_ns / 1000.0);
+
+						out << (first ? "\n" : ",\n") << "{\"name\":\"";
+						_trace::write_escaped(out, event.name);
+						out << "\",\"ph\":\"X\"," << times << ",\"pid\":" << pid
+						    << ",\"tid\":" << buffer->tid << '}';
+
+						first = false;
+					}
+				}
+			}
+
+			uint64_t now = _trace::since_epoch(clock::now());
+
+			out << (first ? "\n" : ",\n") << "{\"name\":\"ld\",\"ph\":\"C\","
+			    << "\"ts\":" << now / 1000 << ",\"pid\":" << pid
+			    << ",\"tid\":0,\"args\":{";
+
+			for (size_t i = 0; i < COUNTER_COUNT; i++) {
+				auto counter = static_cast<Counter>(i);
+
+				out << (i == 0 ? "" : ",") << '"' << counter_name(counter)
+				    << "\":" << get(counter);
+			}
+
+			out << "}}\n]}\n";
+		}
+
+		/**
+		 * [[write_chrome_trace]] to a file. Throws [[std::runtime_error]] if
+		 * it can't be written.
+		 *
+		 * @param path
+		 */
+		inline void write_chrome_trace(const std::string & path) {
+			std::ofstream out(path);
+
+			if (!out) {
+				throw std::runtime_error("can't open " + path);
+			}
+
+			write_chrome_trace(static_cast<std::ostream &>(out));
+		}
+	}
+}
+
+#endif //__LD_TRACE_SPANS_HPP
@@ -1,12 +1,26 @@
 #ifndef __LD_TUI_HPP
 #define __LD_TUI_HPP
 
-#include <unistd.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/ioctl.h>
 #include <termios.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+#include <iterator>
+#include <optional>
+#include <string>
 #include <vector>
 
 #include "ld_ansi.hpp"
+#include "ld_config.hpp"
+#include "ld_output.hpp"
 #include "ld_sutil.hpp"
+#include "ld_trace.hpp"
 
 namespace LD {
 	namespace TUI {
@@ -15,8 +29,12 @@ namespace LD {
 			 * An enum of all possible keys. Only the first 128 can be
 			 * returned by [[LD::TUI::_getch]], [[LD::TUI::getch]] uses
 			 * the values above 127.
+			 *
+			 * [[LD::TUI::getch]] can also OR in any of the MOD_ flags, use
+			 * [[LD::TUI::Keys::base]] and [[LD::TUI::Keys::mods]] to pull
+			 * them apart.
 			 */
-			enum Key : unsigned wchar_t {
+			enum Key : unsigned int {
 				NUL = 0, SOH, STX, ETC, EOT, ENQ, ACK, BEL, BS, TAB, LF, VT, FF,
 				CR, SO, SI, DLE, DC1, DC2, DC3, DC4, NAK, SYN, ETB, CAN, EM,
 				SUB, ESC, FS, GS, RS, US, SPACE, EXCLAMATION, DBL_QUOTE,
@@ -30,134 +48,1180 @@ namespace LD {
 				f, g, h, i, j, k, l, m, n, o, p, q, r, s, t, u, v, w, x, y, z,
 				LEFT_CURLY_BRACE, PIPE, RIGHT_CURLY_BRACE, TILDE, DELETE,
 				F1, F2, F3, F4, F5, F6, F7, F8, F9, F10, F11, F12,
-				UP, DOWN, RIGHT, LEFT
+				UP, DOWN, RIGHT, LEFT, HOME, END, INSERT, DEL, PAGE_UP,
+				PAGE_DOWN, UNKNOWN, PASTE, MOUSE,
+
+				MOD_SHIFT = 1u << 16,
+				MOD_ALT   = 1u << 17,
+				MOD_CTRL  = 1u << 18,
+				MODS      = MOD_SHIFT | MOD_ALT | MOD_CTRL
 			};
 
-			static std::vector<std::wstring> key_debug;
+			/**
+			 * The name of each key without modifiers, indexed by [[Key]].
+			 * Plain pointers to literals, so the table is built at compile
+			 * time instead of during startup.
+			 */
+			static const wchar_t * const key_debug[MOUSE + 1];
+
+			/**
+			 * @param key
+			 * @return `key` without any modifiers
+			 */
+			static Key base(Key key) {
+				return static_cast<Key>(key & ~MODS);
+			}
+
+			/**
+			 * @param key
+			 * @return Only the modifiers of `key`
+			 */
+			static unsigned int mods(Key key) {
+				return key & MODS;
+			}
+
+			/**
+			 * @param key
+			 * @param mods Any of the MOD_ flags.
+			 * @return `key` with `mods` added
+			 */
+			static Key with_mods(Key key, unsigned int mods) {
+				return static_cast<Key>(key | (mods & MODS));
+			}
+
+			/**
+			 * [[key_debug]], but also works for modified keys, like
+			 * "CTRL+SHIFT+UP".
+			 *
+			 * @param key
+			 * @return
+			 */
+			static std::wstring name(Key key) {
+				std::wstring built;
+
+				if (key & MOD_CTRL) {
+					built.append(L"CTRL+");
+				}
+
+				if (key & MOD_ALT) {
+					built.append(L"ALT+");
+				}
+
+				if (key & MOD_SHIFT) {
+					built.append(L"SHIFT+");
+				}
+
+				Key b = base(key);
+
+				if (b < std::size(key_debug)) {
+					built.append(key_debug[b]);
+				} else {
+					built.append(L"UNKNOWN");
+				}
+
+				return built;
+			}
 		};
 
 		/**
-		 * Gets one character from the connected terminal.
+		 * Puts the terminal into raw mode (no line buffering, no echo) for as
+		 * long as it's alive, and puts it back how it was when it dies.
+		 * Sessions nest, so only the outermost one actually touches the
+		 * terminal.
 		 *
-		 * @return The character. Can only be in the range 0-127,
-		 * inclusive.
+		 * The original settings are also restored if the process is killed
+		 * by SIGINT, SIGTERM, SIGHUP or SIGQUIT, or exits without unwinding
+		 * the stack. So are the terminal modes switched through it, like
+		 * [[alt_screen]] and [[hide_cursor]], so a full-screen app that's
+		 * interrupted doesn't leave the shell on the alternate screen.
+		 *
+		 * Hold one of these around anything that reads a lot of keys, like a
+		 * menu loop, so that [[LD::TUI::getch]] doesn't switch modes every
+		 * time it's called.
 		 */
-		unsigned char _getch() {
-			unsigned char  buf = 0;
-			struct termios old {};
+		class RawMode {
+			public:
+				RawMode() {
+					if (state().depth++ == 0) {
+						enter();
+					}
+				}
 
-			tcgetattr(0, & old);
+				~RawMode() {
+					if (--state().depth == 0) {
+						leave();
+					}
+				}
 
-			tcflag_t old_icanon = old.c_lflag & ICANON,
-			         old_echo   = old.c_lflag & ECHO;
-			cc_t     old_vmin   = old.c_cc[VMIN],
-			         old_vtime  = old.c_cc[VTIME];
+				RawMode(const RawMode &) = delete;
+				RawMode & operator=(const RawMode &) = delete;
 
-			old.c_lflag &= ~ICANON;
-			old.c_lflag &= ~ECHO;
-			old.c_cc[VMIN]  = 1;
-			old.c_cc[VTIME] = 0;
+				/**
+				 * @return Whether there's a raw mode session right now.
+				 */
+				static bool active() {
+					return state().depth > 0;
+				}
 
-			tcsetattr(0, TCSANOW, & old);
-			read(0, & buf, 1);
+				/**
+				 * Turns bracketed paste mode on or off. While it's on, the
+				 * terminal wraps pastes in markers so they can be delivered as
+				 * a single [[LD::TUI::Keys::PASTE]] instead of being typed out
+				 * key by key. It's turned off again along with raw mode, even
+				 * if that happens because of a signal.
+				 *
+				 * @param on
+				 */
+				static void bracketed_paste(bool on) {
+					State & st = state();
 
-			old.c_lflag |= old_icanon;
-			old.c_lflag |= old_echo;
-			old.c_cc[VMIN]  = old_vmin;
-			old.c_cc[VTIME] = old_vtime;
+					if (on) {
+						send(PASTE_ON, sizeof(PASTE_ON) - 1);
+					} else {
+						send(PASTE_OFF, sizeof(PASTE_OFF) - 1);
+					}
 
-			tcsetattr(0, TCSADRAIN, & old);
+					st.paste = on;
+				}
 
-			return buf;
-		}
+				/**
+				 * Turns mouse tracking on or off. While it's on, clicks, the
+				 * wheel and all mouse motion are reported in SGR (1006) mode
+				 * and come out of [[LD::TUI::getch]] as
+				 * [[LD::TUI::Keys::MOUSE]]. Like [[bracketed_paste]], it's
+				 * turned off again along with raw mode.
+				 *
+				 * @param on
+				 */
+				static void mouse_tracking(bool on) {
+					State & st = state();
 
-#pragma clang diagnostic push
-#pragma ide diagnostic ignored "RedundantCast"
-#pragma ide diagnostic ignored "missing_default_case"
+					if (on) {
+						send(MOUSE_ON, sizeof(MOUSE_ON) - 1);
+					} else {
+						send(MOUSE_OFF, sizeof(MOUSE_OFF) - 1);
+					}
 
-		Keys::Key getch() {
-			unsigned char ch = _getch();
+					st.mouse = on;
+				}
 
-			if (ch != Keys::ESC) {
-				return static_cast<Keys::Key>(ch);
-			}
+				/**
+				 * Switches to the alternate screen, or back. Like
+				 * [[bracketed_paste]], it's switched back along with raw
+				 * mode, even if that happens because of a signal.
+				 *
+				 * @param on
+				 */
+				static void alt_screen(bool on) {
+					State & st = state();
+
+					if (on) {
+						send(ALT_ON, sizeof(ALT_ON) - 1);
+					} else {
+						send(ALT_OFF, sizeof(ALT_OFF) - 1);
+					}
 
-			switch (_getch()) {
-				case Keys::LEFT_SQUARE_BRACKET: {
-					ch = _getch();
+					st.alt = on;
+				}
+
+				/**
+				 * Hides the cursor, or shows it again. Like [[alt_screen]],
+				 * it's shown again along with raw mode.
+				 *
+				 * @param hide
+				 */
+				static void hide_cursor(bool hide) {
+					State & st = state();
 
-					if (ch >= Keys::A && ch <= Keys::D) {
-						return static_cast<Keys::Key>(Keys::UP + ch -
-						                              Keys::A);
+					if (hide) {
+						send(CURSOR_OFF, sizeof(CURSOR_OFF) - 1);
+					} else {
+						send(CURSOR_ON, sizeof(CURSOR_ON) - 1);
 					}
 
-					auto key = static_cast<Keys::Key>(ch);
+					st.cursor_hidden = hide;
+				}
+
+			private:
+				static constexpr int SIGNALS[] = {
+					SIGINT, SIGTERM, SIGHUP, SIGQUIT
+				};
 
-					switch (ch) {
-						case Keys::ONE:
-							switch (_getch()) {
-								case Keys::FIVE:
-									key = Keys::F5;
+				static constexpr char PASTE_ON[]  = "\033[?2004h";
+				static constexpr char PASTE_OFF[] = "\033[?2004l";
+				static constexpr char MOUSE_ON[]  = "\033[?1003h\033[?1006h";
+				static constexpr char MOUSE_OFF[] = "\033[?1006l\033[?1003l";
+				static constexpr char ALT_ON[]     = "\033[?1049h";
+				static constexpr char ALT_OFF[]    = "\033[?1049l";
+				static constexpr char CURSOR_OFF[] = "\033[?25l";
+				static constexpr char CURSOR_ON[]  = "\033[?25h";
 
-									break;
-								case Keys::SEVEN:
-									key = Keys::F6;
+				struct State {
+					int depth = 0;
 
-									break;
-								case Keys::EIGHT:
-									key = Keys::F7;
+					/**
+					 * false if stdin isn't a terminal, in which case there
+					 * are no settings to restore
+					 */
+					volatile sig_atomic_t saved = 0;
+					volatile sig_atomic_t paste = 0;
+					volatile sig_atomic_t mouse = 0;
+					volatile sig_atomic_t alt   = 0;
+					volatile sig_atomic_t cursor_hidden = 0;
+					bool                  atexit_registered = false;
 
-									break;
-								case Keys::NINE:
-									key = Keys::F8;
+					struct termios   original {};
+					struct sigaction old_actions[sizeof(SIGNALS) /
+					                             sizeof(* SIGNALS)] {};
+				};
 
-									break;
-							}
+				static State & state() {
+					static State st;
 
-							break;
-						case Keys::TWO:
-							switch (_getch()) {
-								case Keys::ZERO:
-									key = Keys::F9;
+					return st;
+				}
 
-									break;
-								case Keys::ONE:
-									key = Keys::F10;
+				static void enter();
 
-									break;
-								case Keys::THREE:
-									key = Keys::F11;
+				static void leave();
 
-									break;
-								case Keys::FOUR:
-									key = Keys::F12;
+				/**
+				 * Only does async-signal-safe things, since it's also called
+				 * from [[on_signal]].
+				 */
+				static void restore();
+
+				static void on_signal(int sig);
+
+				/**
+				 * Sends a mode switch to the [[LD::output_sink]] if there is
+				 * one, like everything else written with [[LD::o]], or
+				 * straight to the terminal, after anything still buffered.
+				 */
+				static void send(const char * seq, size_t len) {
+					if (output_sink()) {
+						wchar_t wide[32];
+						size_t  size = len < std::size(wide) ? len : std::size(wide);
+
+						for (size_t i = 0; i < size; i++) {
+							wide[i] = static_cast<wchar_t>(seq[i]);
+						}
+
+						output_sink()(std::wstring_view(wide, size));
+					} else {
+						std::fflush(stdout);
+						write_all(seq, len);
+					}
+				}
 
-									break;
-							}
+				static void write_all(const char * str, size_t len) {
+					while (len > 0) {
+						ssize_t wrote = write(1, str, len);
 
+						if (wrote < 0 && errno == EINTR) {
+							continue;
+						} else if (wrote <= 0) {
 							break;
+						}
+
+						str += wrote;
+						len -= static_cast<size_t>(wrote);
+					}
+				}
+		};
+
+		/**
+		 * Buffers input from a file descriptor. Every [[read]] pulls in as
+		 * many bytes as are available instead of just one, so a whole escape
+		 * sequence (or a whole paste) usually arrives in one syscall.
+		 */
+		class InputReader {
+			public:
+				explicit InputReader(int fd = 0) : fd(fd) {}
+
+				/**
+				 * The reader for stdin, which everything in [[LD::TUI]] shares
+				 * so that bytes read ahead by one call aren't lost to the
+				 * next.
+				 *
+				 * @return
+				 */
+				static InputReader & stdin_reader() {
+					static InputReader reader(0);
+
+					return reader;
+				}
+
+				/**
+				 * Reads whatever is available into the buffer, waiting at most
+				 * `timeout_ms` milliseconds for something to show up. A
+				 * negative timeout waits forever.
+				 *
+				 * @param timeout_ms
+				 * @return false on timeout, EOF or error
+				 */
+				bool fill(int timeout_ms = -1) {
+					if (timeout_ms >= 0) {
+						struct pollfd pfd {fd, POLLIN, 0};
+
+						if (poll(& pfd, 1, timeout_ms) <= 0) {
+							return false;
+						}
+					}
+
+					if (start > 0) {
+						std::memmove(buf, buf + start, end - start);
+						end -= start;
+						start = 0;
+					}
+
+					if (end == sizeof(buf)) {
+						return true;
+					}
+
+					ssize_t got;
+
+					do {
+						LD_STAT(INPUT_READS, 1);
+						got = read(fd, buf + end, sizeof(buf) - end);
+					} while (got < 0 && errno == EINTR);
+
+					if (got <= 0) {
+						closed = got == 0 || errno != EAGAIN;
+
+						return false;
+					}
+
+					end += static_cast<size_t>(got);
+
+					return true;
+				}
+
+				size_t available() const {
+					return end - start;
+				}
+
+				bool empty() const {
+					return start == end;
+				}
+
+				/**
+				 * @return Whether the last [[fill]] hit EOF or an error.
+				 */
+				bool eof() const {
+					return closed;
+				}
+
+				/**
+				 * @return The buffered bytes, [[available]] of them.
+				 */
+				const unsigned char * data() const {
+					return buf + start;
+				}
+
+				/**
+				 * Drops `n` bytes from the front of the buffer.
+				 *
+				 * @param n
+				 */
+				void consume(size_t n) {
+					start += n;
+
+					if (start == end) {
+						start = end = 0;
 					}
+				}
+
+				/**
+				 * Takes one byte off the front of the buffer. Don't call this
+				 * if it's [[empty]].
+				 *
+				 * @return
+				 */
+				unsigned char take() {
+					unsigned char ch = buf[start];
+
+					consume(1);
+
+					return ch;
+				}
+
+			private:
+				int           fd;
+				unsigned char buf[4096] {};
+				size_t        start  = 0;
+				size_t        end    = 0;
+				bool          closed = false;
+		};
+
+		/**
+		 * Gets the size of the connected terminal, or 80x24 if it can't be
+		 * determined (for example because stdout isn't a terminal).
+		 *
+		 * @return The width and height, in that order, like
+		 * [[LD::get_dimensions]].
+		 */
+		LD_DECL std::pair<size_t, size_t> terminal_size();
+
+		/**
+		 * Gets one character from the connected terminal. If there's a
+		 * [[LD::TUI::RawMode]] session this is just a buffer read most of the
+		 * time, otherwise it starts one for the duration of the call.
+		 *
+		 * @return The character. Can only be in the range 0-127,
+		 * inclusive. 0 is also returned on EOF.
+		 */
+		LD_DECL unsigned char _getch();
+
+		/**
+		 * A mouse report. See [[LD::TUI::RawMode::mouse_tracking]].
+		 */
+		struct Mouse {
+			enum Button {
+				LEFT, MIDDLE, RIGHT, NONE, WHEEL_UP, WHEEL_DOWN, WHEEL_LEFT,
+				WHEEL_RIGHT, EXTRA
+			};
+
+			Button button = NONE;
+
+			/**
+			 * 0-based, like [[LD::ANSI::c_mov]].
+			 */
+			size_t x = 0;
+			size_t y = 0;
+
+			/**
+			 * true if the button was let go, false if it was pressed or is
+			 * being held while the mouse moves.
+			 */
+			bool released = false;
+
+			/**
+			 * true if the mouse moved instead of a button changing.
+			 */
+			bool motion = false;
+
+			/**
+			 * Any of the MOD_ flags from [[LD::TUI::Keys::Key]].
+			 */
+			unsigned int mods = 0;
+		};
+
+		/**
+		 * Turns raw terminal input into [[LD::TUI::Keys::Key]]s. Escape
+		 * sequences are parsed generically (CSI parameters and final byte,
+		 * or SS3 and one byte) and then looked up in a table, so unknown
+		 * sequences are still consumed whole instead of leaking into the
+		 * input as stray characters.
+		 *
+		 * xterm modifier parameters (like ESC [ 1 ; 5 A for Ctrl+Up) are
+		 * decoded into the MOD_ flags, and ESC followed by a plain character
+		 * is decoded as Alt plus that character.
+		 *
+		 * Bracketed pastes (see [[LD::TUI::RawMode::bracketed_paste]]) are
+		 * copied out of the input buffer in bulk and come out as a single
+		 * [[LD::TUI::Keys::PASTE]], whose text is in [[take_paste]].
+		 *
+		 * SGR mouse reports (see [[LD::TUI::RawMode::mouse_tracking]]) come
+		 * out as [[LD::TUI::Keys::MOUSE]], with the details in [[mouse]].
+		 */
+		class KeyDecoder {
+			public:
+				/**
+				 * How long to wait after an ESC before deciding it was the
+				 * escape key rather than the start of a sequence. Terminals
+				 * send whole sequences in one write, so this only has to
+				 * cover the gap between packets on slow links.
+				 */
+				int escape_timeout_ms = 25;
+
+				/**
+				 * The decoder [[LD::TUI::getch]] and [[LD::TUI::poll_key]] use.
+				 *
+				 * @return
+				 */
+				static KeyDecoder & shared() {
+					static KeyDecoder decoder;
+
+					return decoder;
+				}
+
+				/**
+				 * Decodes the next key out of `in` and consumes its bytes.
+				 *
+				 * @param in
+				 * @param key Where to put the key.
+				 * @param final See [[decode]]. A paste is only cut short if
+				 * `in` has also hit EOF.
+				 * @return false if more input is needed first
+				 */
+				bool next(InputReader & in, Keys::Key & key, bool final) {
+					if (pasting) {
+						return continue_paste(in, key);
+					}
+
+					if (in.empty()) {
+						return false;
+					}
+
+					size_t used = decode(in.data(), in.available(), key, final);
+
+					if (used == 0) {
+						return false;
+					}
+
+					in.consume(used);
+					LD_STAT(KEYS_DECODED, 1);
+
+					if (key == Keys::PASTE) {
+						pasting = true;
+						paste.clear();
+
+						return continue_paste(in, key);
+					}
+
+					return true;
+				}
+
+				/**
+				 * @return Whether a paste has started but not finished.
+				 */
+				bool in_paste() const {
+					return pasting;
+				}
+
+				/**
+				 * Gets the text of the last [[LD::TUI::Keys::PASTE]], exactly
+				 * as the terminal sent it.
+				 *
+				 * @return
+				 */
+				std::string take_paste() {
+					return std::move(paste);
+				}
+
+				/**
+				 * @return The last [[LD::TUI::Keys::MOUSE]] report.
+				 */
+				const Mouse & mouse() const {
+					return last_mouse;
+				}
+
+				/**
+				 * Decodes one key from the front of `data`.
+				 *
+				 * @param data
+				 * @param len Must be at least 1.
+				 * @param key Where to put the key.
+				 * @param final If true, no more input is coming any time soon,
+				 * so anything incomplete is resolved as best it can be.
+				 * @return How many bytes were used, or 0 if `data` is the
+				 * start of a sequence that isn't complete yet.
+				 */
+				size_t decode(const unsigned char * data, size_t len,
+				              Keys::Key & key, bool final);
+
+			private:
+				static constexpr char PASTE_END[] = "\033[201~";
+
+				bool        pasting = false;
+				std::string paste;
+				Mouse       last_mouse;
+
+				/**
+				 * Moves everything up to the end marker into [[paste]]. Only
+				 * ESC bytes have to be looked at individually, everything in
+				 * between is copied with one append.
+				 */
+				bool continue_paste(InputReader & in, Keys::Key & key);
+
+				bool finish_if_closed(InputReader & in, Keys::Key & key);
+
+				/**
+				 * Anything longer than this isn't a key, it's garbage.
+				 */
+				static constexpr size_t MAX_SEQUENCE = 32;
+
+				/**
+				 * Keys for CSI and SS3 sequences that are identified by their
+				 * final byte, indexed by final byte - '@'.
+				 */
+				static constexpr Keys::Key FINAL_KEYS[] = {
+					// @ A-G
+					Keys::UNKNOWN, Keys::UP, Keys::DOWN, Keys::RIGHT,
+					Keys::LEFT, Keys::UNKNOWN, Keys::END, Keys::UNKNOWN,
+					// H-O
+					Keys::HOME, Keys::UNKNOWN, Keys::UNKNOWN, Keys::UNKNOWN,
+					Keys::UNKNOWN, Keys::UNKNOWN, Keys::UNKNOWN, Keys::UNKNOWN,
+					// P-S
+					Keys::F1, Keys::F2, Keys::F3, Keys::F4
+				};
+
+				/**
+				 * Keys for CSI n ~ sequences, indexed by n.
+				 */
+				static constexpr Keys::Key TILDE_KEYS[] = {
+					Keys::UNKNOWN, Keys::HOME, Keys::INSERT, Keys::DEL,
+					Keys::END, Keys::PAGE_UP, Keys::PAGE_DOWN, Keys::HOME,
+					Keys::END, Keys::UNKNOWN, Keys::UNKNOWN, Keys::F1,
+					Keys::F2, Keys::F3, Keys::F4, Keys::F5, Keys::UNKNOWN,
+					Keys::F6, Keys::F7, Keys::F8, Keys::F9, Keys::F10,
+					Keys::UNKNOWN, Keys::F11, Keys::F12
+				};
+
+				static Keys::Key final_key(unsigned char ch) {
+					size_t i = ch - static_cast<unsigned char>('@');
+
+					if (ch < '@' || i >= std::size(FINAL_KEYS)) {
+						return Keys::UNKNOWN;
+					}
+
+					return FINAL_KEYS[i];
+				}
+
+				/**
+				 * Turns an xterm modifier parameter into MOD_ flags. The
+				 * parameter is 1 + a bitmask of shift (1), alt (2), ctrl (4)
+				 * and meta (8), which is treated as alt.
+				 */
+				static unsigned int modifier_flags(unsigned int param) {
+					if (param < 2) {
+						return 0;
+					}
+
+					unsigned int bits  = param - 1;
+					unsigned int flags = 0;
+
+					if (bits & 1) {
+						flags |= Keys::MOD_SHIFT;
+					}
+
+					if (bits & (2 | 8)) {
+						flags |= Keys::MOD_ALT;
+					}
+
+					if (bits & 4) {
+						flags |= Keys::MOD_CTRL;
+					}
+
+					return flags;
+				}
+
+				/**
+				 * Returned for sequences that can't be finished, either
+				 * because they're malformed or because input stopped halfway
+				 * through. Everything up to `used` is thrown away.
+				 */
+				static size_t unknown(Keys::Key & key, size_t used) {
+					key = Keys::UNKNOWN;
+
+					return used;
+				}
+
+				size_t decode_csi(const unsigned char * data, size_t len,
+				                  Keys::Key & key, bool final);
+
+				/**
+				 * Decodes the parameters of an SGR mouse report, ESC [ < b ;
+				 * x ; y M (or m for a release).
+				 */
+				void decode_mouse(const unsigned int (& params)[4],
+				                  bool released);
+
+				size_t decode_ss3(const unsigned char * data, size_t len,
+				                  Keys::Key & key, bool final) const;
+		};
+
+		/**
+		 * Decodes one key from the stdin buffer, reading more input as
+		 * needed. An incomplete escape sequence is given at most
+		 * [[LD::TUI::KeyDecoder::escape_timeout_ms]] to finish. For
+		 * [[LD::TUI::Keys::PASTE]], the text is in
+		 * [[LD::TUI::KeyDecoder::take_paste]].
+		 *
+		 * @param timeout_ms How long to wait for the first byte, negative to
+		 * wait forever.
+		 * @param key Where to put the key.
+		 * @return false if nothing arrived in time, or stdin was closed
+		 */
+		LD_DECL bool poll_key(int timeout_ms, Keys::Key & key);
+
+		/**
+		 * Waits for a key from the terminal and decodes it, including escape
+		 * sequences for arrows, function keys, Home/End/PgUp/PgDn and
+		 * modifiers.
+		 *
+		 * @return The key, or [[LD::TUI::Keys::NUL]] if stdin was closed.
+		 */
+		LD_DECL Keys::Key getch();
+	}
+}
+
+#if LD_DEFINITIONS
+namespace LD {
+	namespace TUI {
+		LD_DECL void RawMode::enter() {
+			State & st = state();
+
+			// the handlers go in even if stdin isn't a terminal, since the
+			// modes switched on stdout still have to be switched back
+			struct sigaction action {};
+			action.sa_handler = on_signal;
+			sigemptyset(& action.sa_mask);
+
+			for (size_t i = 0; i < std::size(SIGNALS); i++) {
+				sigaction(SIGNALS[i], & action, & st.old_actions[i]);
+			}
+
+			if (!st.atexit_registered) {
+				st.atexit_registered = true;
+				std::atexit(restore);
+			}
+
+			if (tcgetattr(0, & st.original) != 0) {
+				return;
+			}
+
+			struct termios raw = st.original;
+
+			raw.c_lflag &= ~(ICANON | ECHO);
+			raw.c_cc[VMIN]  = 1;
+			raw.c_cc[VTIME] = 0;
+
+			st.saved = 1;
+
+			tcsetattr(0, TCSANOW, & raw);
+		}
+
+		LD_DECL void RawMode::leave() {
+			State & st = state();
+
+			if (st.paste) {
+				bracketed_paste(false);
+			}
+
+			if (st.mouse) {
+				mouse_tracking(false);
+			}
+
+			if (st.cursor_hidden) {
+				hide_cursor(false);
+			}
+
+			if (st.alt) {
+				alt_screen(false);
+			}
+
+			if (st.saved) {
+				tcsetattr(0, TCSADRAIN, & st.original);
+				st.saved = 0;
+			}
+
+			for (size_t i = 0; i < std::size(SIGNALS); i++) {
+				sigaction(SIGNALS[i], & st.old_actions[i], nullptr);
+			}
+		}
+
+		LD_DECL void RawMode::restore() {
+			State & st = state();
+
+			if (st.paste) {
+				write_all(PASTE_OFF, sizeof(PASTE_OFF) - 1);
+				st.paste = 0;
+			}
+
+			if (st.mouse) {
+				write_all(MOUSE_OFF, sizeof(MOUSE_OFF) - 1);
+				st.mouse = 0;
+			}
+
+			if (st.cursor_hidden) {
+				write_all(CURSOR_ON, sizeof(CURSOR_ON) - 1);
+				st.cursor_hidden = 0;
+			}
+
+			if (st.alt) {
+				write_all(ALT_OFF, sizeof(ALT_OFF) - 1);
+				st.alt = 0;
+			}
 
-					_getch();
+			if (st.saved) {
+				tcsetattr(0, TCSANOW, & st.original);
+				st.saved = 0;
+			}
+		}
+
+		LD_DECL void RawMode::on_signal(int sig) {
+			State & st = state();
+
+			restore();
+
+			for (size_t i = 0; i < std::size(SIGNALS); i++) {
+				if (SIGNALS[i] == sig) {
+					sigaction(sig, & st.old_actions[i], nullptr);
+				}
+			}
+
+			raise(sig);
+		}
+
+		LD_DECL size_t KeyDecoder::decode(const unsigned char * data,
+		                                  size_t len, Keys::Key & key,
+		                                  bool final) {
+			if (data[0] != Keys::ESC) {
+				key = static_cast<Keys::Key>(data[0]);
+
+				return 1;
+			}
 
-					return key;
+			if (len == 1) {
+				if (!final) {
+					return 0;
 				}
+
+				key = Keys::ESC;
+
+				return 1;
+			}
+
+			switch (data[1]) {
+				case Keys::LEFT_SQUARE_BRACKET:
+					return decode_csi(data, len, key, final);
 				case Keys::O:
-					ch = _getch();
+					return decode_ss3(data, len, key, final);
+				case Keys::ESC:
+					// the second one starts its own sequence
+					key = Keys::ESC;
+
+					return 1;
+				default:
+					key = Keys::with_mods(
+						static_cast<Keys::Key>(data[1]), Keys::MOD_ALT
+					);
+
+					return 2;
+			}
+		}
+
+		LD_DECL bool KeyDecoder::continue_paste(InputReader & in,
+		                                        Keys::Key & key) {
+			constexpr size_t marker = sizeof(PASTE_END) - 1;
+
+			const auto * data = in.data();
+			size_t       len  = in.available();
+			size_t       i    = 0;
+
+			while (i < len) {
+				const void * esc = std::memchr(data + i, Keys::ESC,
+				                               len - i);
+
+				if (esc == nullptr) {
+					break;
+				}
+
+				size_t pos  = static_cast<const unsigned char *>(esc) -
+				              data;
+				size_t rest = len - pos;
+
+				if (std::memcmp(data + pos, PASTE_END,
+				                rest < marker ? rest : marker) != 0) {
+					// just an ESC in the pasted text
+					i = pos + 1;
+
+					continue;
+				}
+
+				paste.append(reinterpret_cast<const char *>(data), pos);
+
+				if (rest < marker) {
+					// the rest of the marker hasn't arrived yet
+					in.consume(pos);
+
+					return finish_if_closed(in, key);
+				}
+
+				in.consume(pos + marker);
+				pasting = false;
+				key     = Keys::PASTE;
+
+				return true;
+			}
+
+			paste.append(reinterpret_cast<const char *>(data), len);
+			in.consume(len);
+
+			return finish_if_closed(in, key);
+		}
+
+		LD_DECL bool KeyDecoder::finish_if_closed(InputReader & in,
+		                                          Keys::Key & key) {
+			if (!in.eof()) {
+				return false;
+			}
+
+			paste.append(reinterpret_cast<const char *>(in.data()),
+			             in.available());
+			in.consume(in.available());
+
+			pasting = false;
+			key     = Keys::PASTE;
+
+			return true;
+		}
+
+		LD_DECL size_t KeyDecoder::decode_csi(const unsigned char * data,
+		                                      size_t len, Keys::Key & key,
+		                                      bool final) {
+			unsigned int params[4] {};
+			size_t       nparams = 0;
+			bool         digits  = false;
+			size_t       i       = 2;
+
+			// private markers like < or ? mean it's not a key
+			unsigned char priv = 0;
 
-					if (ch >= Keys::P && ch <= Keys::S) {
-						return static_cast<Keys::Key>(Keys::F1 + ch - Keys::P);
+			if (i < len && data[i] >= '<' && data[i] <= '?') {
+				priv = data[i++];
+			}
+
+			for (; i < len && i < MAX_SEQUENCE; i++) {
+				unsigned char ch = data[i];
+
+				if (ch >= '0' && ch <= '9') {
+					if (nparams < std::size(params)) {
+						params[nparams] =
+							params[nparams] * 10 + (ch - '0');
+					}
+
+					digits = true;
+				} else if (ch == ';' || ch == ':') {
+					nparams++;
+					digits = false;
+				} else if (ch >= 0x20 && ch <= 0x2f) {
+					// intermediate byte, no keys use these
+				} else if (ch >= 0x40 && ch <= 0x7e) {
+					break;
+				} else {
+					// not part of a CSI sequence at all
+					return unknown(key, i);
+				}
+			}
+
+			if (i >= MAX_SEQUENCE) {
+				return unknown(key, i);
+			}
+
+			if (i == len) {
+				if (!final) {
+					return 0;
+				}
+
+				if (len == 2) {
+					// nothing after the [, so it was Alt+[
+					key = Keys::with_mods(
+						Keys::LEFT_SQUARE_BRACKET, Keys::MOD_ALT
+					);
+
+					return 2;
+				}
+
+				return unknown(key, len);
+			}
+
+			if (digits) {
+				nparams++;
+			}
+
+			unsigned char fin  = data[i];
+			size_t        used = i + 1;
+
+			if (priv == '<' && (fin == 'M' || fin == 'm') &&
+			    nparams == 3) {
+				decode_mouse(params, fin == 'm');
+				key = Keys::MOUSE;
+
+				return used;
+			}
+
+			if (priv) {
+				return unknown(key, used);
+			}
+
+			if (fin == '~') {
+				if (nparams == 1 && params[0] == 200) {
+					key = Keys::PASTE;
+
+					return used;
+				}
+
+				if (nparams == 0 || params[0] >= std::size(TILDE_KEYS)) {
+					return unknown(key, used);
+				}
+
+				key = TILDE_KEYS[params[0]];
+			} else if (fin == 'Z') {
+				key = Keys::with_mods(Keys::TAB, Keys::MOD_SHIFT);
+
+				return used;
+			} else {
+				key = final_key(fin);
+			}
+
+			if (key != Keys::UNKNOWN && nparams >= 2) {
+				key = Keys::with_mods(key, modifier_flags(params[1]));
+			}
+
+			return used;
+		}
+
+		LD_DECL void KeyDecoder::decode_mouse(const unsigned int (& params)[4],
+		                                      bool released) {
+			unsigned int b = params[0];
+			Mouse        mouse;
+
+			if (b & 4) {
+				mouse.mods |= Keys::MOD_SHIFT;
+			}
+
+			if (b & 8) {
+				mouse.mods |= Keys::MOD_ALT;
+			}
+
+			if (b & 16) {
+				mouse.mods |= Keys::MOD_CTRL;
+			}
+
+			if (b & 64) {
+				mouse.button = static_cast<Mouse::Button>(
+					Mouse::WHEEL_UP + (b & 3)
+				);
+			} else if (b & 128) {
+				mouse.button = Mouse::EXTRA;
+			} else {
+				mouse.button = static_cast<Mouse::Button>(b & 3);
+			}
+
+			mouse.motion   = (b & 32) != 0;
+			mouse.released = released;
+			mouse.x        = params[1] > 0 ? params[1] - 1 : 0;
+			mouse.y        = params[2] > 0 ? params[2] - 1 : 0;
+
+			last_mouse = mouse;
+		}
+
+		LD_DECL size_t KeyDecoder::decode_ss3(const unsigned char * data,
+		                                      size_t len, Keys::Key & key,
+		                                      bool final) const {
+			unsigned int mod = 0;
+			size_t       i   = 2;
+
+			// some terminals put the modifier right after the O
+			for (; i < len && data[i] >= '0' && data[i] <= '9'; i++) {
+				mod = mod * 10 + (data[i] - '0');
+
+				if (i >= MAX_SEQUENCE) {
+					return unknown(key, i);
+				}
+			}
+
+			if (i == len) {
+				if (!final) {
+					return 0;
+				}
+
+				if (len == 2) {
+					key = Keys::with_mods(Keys::O, Keys::MOD_ALT);
+
+					return 2;
+				}
+
+				return unknown(key, len);
+			}
+
+			key = final_key(data[i]);
+
+			if (key != Keys::UNKNOWN) {
+				key = Keys::with_mods(key, modifier_flags(mod));
+			}
+
+			return i + 1;
+		}
+
+		LD_DECL std::pair<size_t, size_t> terminal_size() {
+			struct winsize ws {};
+
+			if (ioctl(1, TIOCGWINSZ, & ws) != 0 || ws.ws_col == 0) {
+				return std::make_pair(80, 24);
+			}
+
+			return std::make_pair(ws.ws_col, ws.ws_row);
+		}
+
+		LD_DECL unsigned char _getch() {
+			InputReader & in = InputReader::stdin_reader();
+
+			if (in.empty()) {
+				RawMode raw;
+
+				if (!in.fill()) {
+					return 0;
+				}
+			}
+
+			return in.take();
+		}
+
+		LD_DECL bool poll_key(int timeout_ms, Keys::Key & key) {
+			InputReader & in      = InputReader::stdin_reader();
+			KeyDecoder  & decoder = KeyDecoder::shared();
+
+			// only set up if the terminal actually has to be read, so keys
+			// that are already buffered don't cost any syscalls
+			std::optional<RawMode> raw;
+
+			while (!decoder.next(in, key, false)) {
+				if (!raw) {
+					raw.emplace();
+				}
+
+				if (in.empty() && !decoder.in_paste()) {
+					if (!in.fill(timeout_ms)) {
+						return false;
 					}
+
+					continue;
+				}
+
+				// pastes are one event, so wait for the whole thing
+				int wait = decoder.in_paste() ? -1 : decoder.escape_timeout_ms;
+
+				if (!in.fill(wait)) {
+					if (decoder.next(in, key, true)) {
+						return true;
+					}
+
+					if (in.eof()) {
+						return false;
+					}
+				}
 			}
 
-			return static_cast<Keys::Key>(ch);
+			return true;
 		}
 
-#pragma clang diagnostic pop
+		LD_DECL Keys::Key getch() {
+			Keys::Key key;
+
+			if (!poll_key(-1, key)) {
+				return Keys::NUL;
+			}
+
+			return key;
+		}
 	}
 }
 
-std::vector<std::wstring> LD::TUI::Keys::key_debug = {
+LD_DECL const wchar_t * const LD::TUI::Keys::key_debug[] = {
 	L"NUL", L"SOH", L"STX", L"ETC", L"EOT", L"ENQ", L"ACK", L"BEL", L"BS",
 	L"TAB", L"LF", L"VT", L"FF", L"CR", L"SO", L"SI", L"DLE", L"DC1", L"DC2",
 	L"DC3", L"DC4", L"NAK", L"SYN", L"ETB", L"CAN", L"EM", L"SUB", L"ESC",
@@ -175,7 +1239,10 @@ std::vector<std::wstring> LD::TUI::Keys::key_debug = {
 	L"u", L"v", L"w", L"x", L"y", L"z", L"LEFT_CURLY_BRACE", L"PIPE",
 	L"RIGHT_CURLY_BRACE", L"TILDE", L"DELETE",
 	L"F1", L"F2", L"F3", L"F4", L"F5", L"F6", L"F7", L"F8", L"F9", L"F10",
-	L"F11", L"F12", L"UP", L"DOWN", L"RIGHT", L"LEFT"
+	L"F11", L"F12", L"UP", L"DOWN", L"RIGHT", L"LEFT", L"HOME", L"END",
+	L"INSERT", L"DEL", L"PAGE_UP", L"PAGE_DOWN", L"UNKNOWN", L"PASTE",
+	L"MOUSE"
 };
+#endif
 
 #endif //__LD_TUI_HPP
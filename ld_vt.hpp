@@ -0,0 +1,739 @@
+#ifndef __LD_VT_HPP
+#define __LD_VT_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "ld_config.hpp"
+#include "ld_output.hpp"
+
+namespace LD {
+	/**
+	 * A headless terminal: feed it what the library writes and it keeps
+	 * the screen that a real terminal would show, along with how many
+	 * bytes, escape sequences and cursor moves it took to get there. Meant
+	 * for tests that check both that a render looks right and that it
+	 * doesn't cost more than it should on the wire.
+	 *
+	 * It understands what [[LD::ANSI]] and [[LD::SGR]] emit: cursor
+	 * movement, erasing, SGR attributes and colours, save/restore, the
+	 * alternate screen and cursor visibility. Other sequences are counted
+	 * and otherwise ignored. Every wchar_t takes up one cell, which is how
+	 * the rest of the library measures text too. A newline also goes back
+	 * to the start of the line, like it does on a terminal, since the tty
+	 * adds the carriage return.
+	 *
+	 *     LD::VirtualTerminal vt(80, 24);
+	 *     LD::VtCapture capture(vt);
+	 *
+	 *     LD::o(LD::render_tabulated(table));
+	 *
+	 *     auto stats = vt.end_frame();
+	 *     assert(vt.line(0).substr(0, 3) == L"┌──");
+	 *     assert(stats.bytes < 4096);
+	 */
+	class VirtualTerminal {
+		public:
+			/**
+			 * How the text in a cell is drawn. Colours are -1 for the
+			 * default, 0-255 for the 256-colour palette (which the basic
+			 * and bright colours map into) and 0x1000000 | 0xRRGGBB for
+			 * direct colour.
+			 */
+			struct Style {
+				uint32_t attrs = 0; // bit n is set for SGR code n, 1-9
+				int32_t  fg    = -1;
+				int32_t  bg    = -1;
+
+				bool has(unsigned code) const {
+					return (attrs >> code & 1) != 0;
+				}
+
+				bool operator==(const Style & other) const {
+					return attrs == other.attrs && fg == other.fg &&
+					       bg == other.bg;
+				}
+
+				bool operator!=(const Style & other) const {
+					return !(* this == other);
+				}
+			};
+
+			struct Cell {
+				wchar_t ch = L' ';
+				Style   style;
+			};
+
+			/**
+			 * What was written during a frame, see [[end_frame]].
+			 */
+			struct Stats {
+				size_t writes       = 0; // calls to feed
+				size_t bytes        = 0; // as UTF-8
+				size_t printed      = 0; // characters that landed in a cell
+				size_t sequences    = 0; // escape sequences
+				size_t cursor_moves = 0; // sequences that move the cursor
+				size_t erases       = 0; // erase line/screen sequences
+				size_t sgr          = 0; // SGR sequences
+			};
+
+			VirtualTerminal(size_t width = 80, size_t height = 24)
+				: cols(std::max<size_t>(width, 1)),
+				  rows(std::max<size_t>(height, 1)),
+				  main_grid(cols * rows), alt_grid(cols * rows) {}
+
+			/**
+			 * Runs `text` through the terminal.
+			 *
+			 * @param text
+			 */
+			void feed(std::wstring_view text);
+
+			/**
+			 * @return What's been written since the last call, which starts
+			 * the next frame.
+			 */
+			Stats end_frame();
+
+			/**
+			 * @return What's been written since the last [[end_frame]].
+			 */
+			const Stats & frame_stats() const {
+				return frame;
+			}
+
+			/**
+			 * @return What's been written in all the frames that have ended.
+			 */
+			const Stats & total_stats() const {
+				return totals;
+			}
+
+			size_t width() const {
+				return cols;
+			}
+
+			size_t height() const {
+				return rows;
+			}
+
+			/**
+			 * @return The cursor's column and row, from 0.
+			 */
+			std::pair<size_t, size_t> cursor() const {
+				return std::make_pair(cx, cy);
+			}
+
+			bool cursor_visible() const {
+				return show_cursor;
+			}
+
+			bool alt_screen() const {
+				return in_alt;
+			}
+
+			const Cell & cell(size_t x, size_t y) const {
+				return grid()[y * cols + x];
+			}
+
+			/**
+			 * @param y
+			 * @return The row's text, trailing spaces included.
+			 */
+			std::wstring line(size_t y) const;
+
+			/**
+			 * @return The whole screen, with trailing spaces and blank
+			 * lines at the bottom left off, so it can be compared against
+			 * what was rendered.
+			 */
+			std::wstring screen() const;
+
+			/**
+			 * Clears the screen, homes the cursor and resets the style, like
+			 * a newly opened terminal. Doesn't touch the stats.
+			 */
+			void reset();
+
+		private:
+			enum State {
+				GROUND,
+				ESCAPE,
+				CSI,
+				OSC,
+				OSC_ESCAPE
+			};
+
+			static constexpr size_t MAX_PARAMS = 16;
+
+			size_t cols;
+			size_t rows;
+
+			std::vector<Cell> main_grid;
+			std::vector<Cell> alt_grid;
+			bool              in_alt = false;
+
+			size_t cx           = 0;
+			size_t cy           = 0;
+			size_t saved_x      = 0;
+			size_t saved_y      = 0;
+			bool   pending_wrap = false; // at the right edge, wraps on print
+			bool   show_cursor  = true;
+			Style  style;
+
+			State  state = GROUND;
+			size_t params[MAX_PARAMS];
+			size_t nparams  = 0;
+			bool   has_digit = false;
+			bool   priv      = false;
+
+			Stats frame;
+			Stats totals;
+
+			std::vector<Cell> & grid() {
+				return in_alt ? alt_grid : main_grid;
+			}
+
+			const std::vector<Cell> & grid() const {
+				return in_alt ? alt_grid : main_grid;
+			}
+
+			static size_t utf8_length(wchar_t ch) {
+				auto cp = static_cast<uint32_t>(ch);
+
+				return cp < 0x80 ? 1 : cp < 0x800 ? 2 : cp < 0x10000 ? 3 : 4;
+			}
+
+			static void add(Stats & to, const Stats & from) {
+				to.writes       += from.writes;
+				to.bytes        += from.bytes;
+				to.printed      += from.printed;
+				to.sequences    += from.sequences;
+				to.cursor_moves += from.cursor_moves;
+				to.erases       += from.erases;
+				to.sgr          += from.sgr;
+			}
+
+			void step(wchar_t ch);
+
+			void ground(wchar_t ch);
+
+			void escape(wchar_t ch);
+
+			/**
+			 * @return Parameter `i`, or `fallback` if it's missing or 0.
+			 */
+			size_t param(size_t i, size_t fallback = 1) const {
+				return i < nparams && params[i] != 0 ? params[i] : fallback;
+			}
+
+			void csi(wchar_t final);
+
+			void mode(size_t which, bool on);
+
+			void sgr();
+
+			void move_to(size_t x, size_t y) {
+				cx           = std::min(x, cols - 1);
+				cy           = std::min(y, rows - 1);
+				pending_wrap = false;
+				frame.cursor_moves++;
+			}
+
+			void print(wchar_t ch);
+
+			void line_feed() {
+				pending_wrap = false;
+
+				if (cy + 1 < rows) {
+					cy++;
+				} else {
+					scroll_up();
+				}
+			}
+
+			void scroll_up() {
+				auto & cells = grid();
+
+				std::move(cells.begin() + cols, cells.end(), cells.begin());
+				std::fill(cells.end() - cols, cells.end(), blank());
+			}
+
+			void scroll_down() {
+				auto & cells = grid();
+
+				std::move_backward(cells.begin(), cells.end() - cols,
+				                   cells.end());
+				std::fill(cells.begin(), cells.begin() + cols, blank());
+			}
+
+			/**
+			 * What erased cells become: blank, but with the current
+			 * background, like xterm.
+			 */
+			Cell blank() const {
+				Cell cell;
+
+				cell.style.bg = style.bg;
+
+				return cell;
+			}
+
+			void erase_screen(size_t how);
+
+			void erase_line(size_t how);
+	};
+
+	/**
+	 * Sends everything written with [[LD::o]] to a [[LD::VirtualTerminal]]
+	 * for as long as it's alive, and puts the previous output back when it
+	 * dies.
+	 */
+	class VtCapture {
+		public:
+			explicit VtCapture(VirtualTerminal & vt)
+				: previous(set_output_sink([& vt](std::wstring_view text) {
+					vt.feed(text);
+				})) {}
+
+			~VtCapture() {
+				set_output_sink(std::move(previous));
+			}
+
+			VtCapture(const VtCapture &) = delete;
+			VtCapture & operator=(const VtCapture &) = delete;
+
+		private:
+			OutputSink previous;
+	};
+}
+
+#if LD_DEFINITIONS
+namespace LD {
+	LD_DECL void VirtualTerminal::feed(std::wstring_view text) {
+		frame.writes++;
+
+		for (wchar_t ch : text) {
+			frame.bytes += utf8_length(ch);
+			step(ch);
+		}
+	}
+
+	LD_DECL VirtualTerminal::Stats VirtualTerminal::end_frame() {
+		Stats done = frame;
+
+		add(totals, frame);
+		frame = Stats();
+
+		return done;
+	}
+
+	LD_DECL std::wstring VirtualTerminal::line(size_t y) const {
+		std::wstring text;
+
+		text.reserve(cols);
+
+		for (size_t x = 0; x < cols; x++) {
+			text.push_back(cell(x, y).ch);
+		}
+
+		return text;
+	}
+
+	LD_DECL std::wstring VirtualTerminal::screen() const {
+		std::vector<std::wstring> lines;
+
+		for (size_t y = 0; y < rows; y++) {
+			std::wstring text = line(y);
+
+			text.erase(text.find_last_not_of(L' ') + 1);
+			lines.push_back(std::move(text));
+		}
+
+		while (!lines.empty() && lines.back().empty()) {
+			lines.pop_back();
+		}
+
+		std::wstring result;
+
+		for (size_t i = 0; i < lines.size(); i++) {
+			if (i > 0) {
+				result.push_back(L'\n');
+			}
+
+			result.append(lines[i]);
+		}
+
+		return result;
+	}
+
+	LD_DECL void VirtualTerminal::reset() {
+		std::fill(main_grid.begin(), main_grid.end(), Cell());
+		std::fill(alt_grid.begin(), alt_grid.end(), Cell());
+
+		cx = cy = saved_x = saved_y = 0;
+		pending_wrap = false;
+		show_cursor  = true;
+		in_alt       = false;
+		style        = Style();
+		state        = GROUND;
+	}
+
+	LD_DECL void VirtualTerminal::step(wchar_t ch) {
+		switch (state) {
+			case GROUND:
+				ground(ch);
+
+				break;
+			case ESCAPE:
+				escape(ch);
+
+				break;
+			case CSI:
+				if (ch >= L'0' && ch <= L'9') {
+					if (nparams == 0) {
+						nparams = 1;
+						params[0] = 0;
+					}
+
+					params[nparams - 1] =
+						params[nparams - 1] * 10 + (ch - L'0');
+					has_digit = true;
+				} else if (ch == L';') {
+					if (nparams == 0) {
+						nparams = 1;
+						params[0] = 0;
+					}
+
+					if (nparams < MAX_PARAMS) {
+						params[nparams++] = 0;
+					}
+				} else if (ch == L'?' || ch == L'>' || ch == L'<' ||
+				           ch == L'=') {
+					priv = true;
+				} else if (ch >= 0x40 && ch <= 0x7e) {
+					state = GROUND;
+					csi(ch);
+				} else if (ch < L' ') {
+					// controls still work in the middle of a sequence
+					ground(ch);
+				}
+
+				break;
+			case OSC:
+				if (ch == L'\a') {
+					state = GROUND;
+				} else if (ch == L'\033') {
+					state = OSC_ESCAPE;
+				}
+
+				break;
+			case OSC_ESCAPE:
+				state = ch == L'\\' ? GROUND : OSC;
+
+				break;
+		}
+	}
+
+	LD_DECL void VirtualTerminal::ground(wchar_t ch) {
+		switch (ch) {
+			case L'\033':
+				state = ESCAPE;
+				frame.sequences++;
+
+				break;
+			case L'\r':
+				cx           = 0;
+				pending_wrap = false;
+
+				break;
+			case L'\n':
+				// the tty turns it into \r\n (ONLCR), even in RawMode
+				cx = 0;
+				line_feed();
+
+				break;
+			case L'\v':
+			case L'\f':
+				line_feed();
+
+				break;
+			case L'\b':
+				if (cx > 0) {
+					cx--;
+				}
+
+				pending_wrap = false;
+
+				break;
+			case L'\t':
+				cx           = std::min(cols - 1, (cx / 8 + 1) * 8);
+				pending_wrap = false;
+
+				break;
+			default:
+				if (ch >= L' ' && ch != 0x7f) {
+					print(ch);
+				}
+		}
+	}
+
+	LD_DECL void VirtualTerminal::escape(wchar_t ch) {
+		state = GROUND;
+
+		switch (ch) {
+			case L'[':
+				state     = CSI;
+				nparams   = 0;
+				has_digit = false;
+				priv      = false;
+
+				break;
+			case L']':
+				state = OSC;
+
+				break;
+			case L'7':
+				saved_x = cx;
+				saved_y = cy;
+
+				break;
+			case L'8':
+				move_to(saved_x, saved_y);
+
+				break;
+			case L'D':
+				line_feed();
+				frame.cursor_moves++;
+
+				break;
+			case L'E':
+				line_feed();
+				cx = 0;
+				frame.cursor_moves++;
+
+				break;
+			case L'M':
+				if (cy == 0) {
+					scroll_down();
+				} else {
+					cy--;
+				}
+
+				pending_wrap = false;
+				frame.cursor_moves++;
+
+				break;
+			case L'c':
+				reset();
+
+				break;
+			default:
+				break;
+		}
+	}
+
+	LD_DECL void VirtualTerminal::csi(wchar_t final) {
+		if (priv) {
+			if (final == L'h' || final == L'l') {
+				for (size_t i = 0; i < nparams; i++) {
+					mode(params[i], final == L'h');
+				}
+			}
+
+			return;
+		}
+
+		switch (final) {
+			case L'A':
+				move_to(cx, cy > param(0) ? cy - param(0) : 0);
+
+				break;
+			case L'B':
+			case L'e':
+				move_to(cx, cy + param(0));
+
+				break;
+			case L'C':
+			case L'a':
+				move_to(cx + param(0), cy);
+
+				break;
+			case L'D':
+				move_to(cx > param(0) ? cx - param(0) : 0, cy);
+
+				break;
+			case L'E':
+				move_to(0, cy + param(0));
+
+				break;
+			case L'F':
+				move_to(0, cy > param(0) ? cy - param(0) : 0);
+
+				break;
+			case L'G':
+			case L'`':
+				move_to(param(0) - 1, cy);
+
+				break;
+			case L'd':
+				move_to(cx, param(0) - 1);
+
+				break;
+			case L'H':
+			case L'f':
+				move_to(param(1) - 1, param(0) - 1);
+
+				break;
+			case L'J':
+				frame.erases++;
+				erase_screen(param(0, 0));
+
+				break;
+			case L'K':
+				frame.erases++;
+				erase_line(param(0, 0));
+
+				break;
+			case L'm':
+				frame.sgr++;
+				sgr();
+
+				break;
+			case L's':
+				saved_x = cx;
+				saved_y = cy;
+
+				break;
+			case L'u':
+				move_to(saved_x, saved_y);
+
+				break;
+			default:
+				break;
+		}
+	}
+
+	LD_DECL void VirtualTerminal::mode(size_t which, bool on) {
+		switch (which) {
+			case 25:
+				show_cursor = on;
+
+				break;
+			case 1049:
+				if (on == in_alt) {
+					break;
+				}
+
+				if (on) {
+					saved_x = cx;
+					saved_y = cy;
+					in_alt  = true;
+					std::fill(alt_grid.begin(), alt_grid.end(), Cell());
+				} else {
+					in_alt = false;
+					cx     = saved_x;
+					cy     = saved_y;
+				}
+
+				pending_wrap = false;
+
+				break;
+			default:
+				// paste, mouse, synchronized output, ...
+				break;
+		}
+	}
+
+	LD_DECL void VirtualTerminal::sgr() {
+		if (nparams == 0) {
+			style = Style();
+
+			return;
+		}
+
+		for (size_t i = 0; i < nparams; i++) {
+			size_t code = params[i];
+
+			if (code == 0) {
+				style = Style();
+			} else if (code <= 9) {
+				style.attrs |= 1u << code;
+			} else if (code == 21 || code == 22) {
+				style.attrs &= ~(1u << 1 | 1u << 2);
+			} else if (code >= 23 && code <= 29) {
+				style.attrs &= ~(1u << (code - 20));
+			} else if (code >= 30 && code <= 37) {
+				style.fg = static_cast<int32_t>(code - 30);
+			} else if (code == 39) {
+				style.fg = -1;
+			} else if (code >= 40 && code <= 47) {
+				style.bg = static_cast<int32_t>(code - 40);
+			} else if (code == 49) {
+				style.bg = -1;
+			} else if (code >= 90 && code <= 97) {
+				style.fg = static_cast<int32_t>(code - 90 + 8);
+			} else if (code >= 100 && code <= 107) {
+				style.bg = static_cast<int32_t>(code - 100 + 8);
+			} else if (code == 38 || code == 48) {
+				int32_t & target = code == 38 ? style.fg : style.bg;
+
+				if (i + 2 < nparams && params[i + 1] == 5) {
+					target = static_cast<int32_t>(params[i + 2] & 0xff);
+					i += 2;
+				} else if (i + 4 < nparams && params[i + 1] == 2) {
+					target = static_cast<int32_t>(
+						0x1000000 | (params[i + 2] & 0xff) << 16 |
+						(params[i + 3] & 0xff) << 8 |
+						(params[i + 4] & 0xff)
+					);
+					i += 4;
+				}
+			}
+		}
+	}
+
+	LD_DECL void VirtualTerminal::print(wchar_t ch) {
+		if (pending_wrap) {
+			cx = 0;
+			line_feed();
+		}
+
+		grid()[cy * cols + cx] = Cell {ch, style};
+		frame.printed++;
+
+		if (cx + 1 < cols) {
+			cx++;
+		} else {
+			pending_wrap = true;
+		}
+	}
+
+	LD_DECL void VirtualTerminal::erase_screen(size_t how) {
+		auto & cells = grid();
+		size_t at    = cy * cols + cx;
+
+		if (how == 0) {
+			std::fill(cells.begin() + at, cells.end(), blank());
+		} else if (how == 1) {
+			std::fill(cells.begin(), cells.begin() + at + 1, blank());
+		} else {
+			std::fill(cells.begin(), cells.end(), blank());
+		}
+	}
+
+	LD_DECL void VirtualTerminal::erase_line(size_t how) {
+		auto   row   = grid().begin() + cy * cols;
+		size_t start = how == 0 ? cx : 0;
+		size_t end   = how == 1 ? cx + 1 : cols;
+
+		std::fill(row + start, row + end, blank());
+	}
+}
+#endif
+
+#endif //__LD_VT_HPP
@@ -1,29 +1,36 @@
 #ifndef __LD_WSTR_HPP
 #define __LD_WSTR_HPP
 
-#include <codecvt>
-#include <locale>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <string_view>
 
-#include "ld_num.hpp"
+#include "ld_config.hpp"
+#include "ld_trace.hpp"
 
 namespace LD {
 	/**
-	 * Used by [[LD::s2wstr]] and [[LD::w2str]].
+	 * Appends `src`, which has to be UTF-8, to `out` as a wide string,
+	 * without any temporary strings. Throws [[std::range_error]] if it
+	 * isn't valid UTF-8, the same as [[std::wstring_convert]] used to.
+	 *
+	 * @param src
+	 * @param out
 	 */
-	std::wstring_convert<std::codecvt_utf8_utf16<wchar_t>> converter;
+	LD_DECL void s2wstr(std::string_view src, std::wstring & out);
 
 	/**
 	 * Converts a narrow string (std::string) to a wide string (std::wstring).
+	 * The narrow string has to be UTF-8, see above.
 	 *
 	 * @param src
 	 * @return
 	 */
-	std::wstring s2wstr(const std::string & src) {
-		return converter.from_bytes(src);
-	}
+	LD_DECL std::wstring s2wstr(const std::string & src);
 
 	/**
-	 * [[std::to_string]] but wide.
+	 * [[std::to_string]] but wide. ld_num.hpp adds the precision types.
 	 *
 	 * @param src
 	 * @return
@@ -34,35 +41,43 @@ namespace LD {
 		}
 
 	/**
-	 * Same as above, but works with Unsigned/Rational/etc.
+	 * Appends `src` to `out` as UTF-8, without any temporary strings, so
+	 * a buffer that's reused keeps its capacity. Throws
+	 * [[std::range_error]] on unpaired surrogates.
 	 *
 	 * @param src
-	 * @return
+	 * @param out
 	 */
-	template <>
-		std::wstring wtostring<math::Unsigned>(const math::Unsigned & src) {
-			return s2wstr(src.to_string());
-		}
-
-	template <>
-		std::wstring wtostring<math::Integer>(const math::Integer & src) {
-			return s2wstr(src.to_string());
-		}
-
-	template <>
-		std::wstring wtostring<math::Rational>(const math::Rational & src) {
-			return s2wstr(src.to_string());
-		}
+	LD_DECL void w2str(std::wstring_view src, std::string & out);
 
 	/**
-	 * Converts a wide string (std::wstring) to a narrow string (std::string).
+	 * Converts a wide string (std::wstring) to a narrow string (std::string),
+	 * as UTF-8. Throws [[std::range_error]] on unpaired surrogates.
 	 *
 	 * @param src
 	 * @return
 	 */
-	std::string w2str(const std::wstring & src) {
-		return converter.to_bytes(src);
-	}
+	LD_DECL std::string w2str(const std::wstring & src);
+
+	/**
+	 * Appends `num` in decimal to a wide string with any allocator, without
+	 * going through a temporary like [[wtostring]] does.
+	 *
+	 * @param str
+	 * @param num
+	 */
+	template <class Str>
+		void append_wnum(Str & str, size_t num) {
+			wchar_t digits[20];
+			size_t  i = std::size(digits);
+
+			do {
+				digits[--i] = static_cast<wchar_t>(L'0' + num % 10);
+				num /= 10;
+			} while (num != 0);
+
+			str.append(digits + i, std::size(digits) - i);
+		}
 
 	/**
 	 * Converts a C-string (string literal) to a wide string.
@@ -70,9 +85,148 @@ namespace LD {
 	 * @param src
 	 * @return
 	 */
-	std::wstring c2wstr(const char * src) {
+	LD_DECL std::wstring c2wstr(const char * src);
+}
+
+#if LD_DEFINITIONS
+namespace LD {
+	namespace _wstr {
+		/**
+		 * Appends a code point to a wide string, as a surrogate pair if
+		 * wchar_t is only 16 bits wide (Windows).
+		 */
+		inline void put(std::wstring & out, char32_t cp) {
+			if (sizeof(wchar_t) == 2 && cp >= 0x10000) {
+				cp -= 0x10000;
+
+				out.push_back(static_cast<wchar_t>(0xd800 + (cp >> 10)));
+				out.push_back(static_cast<wchar_t>(0xdc00 + (cp & 0x3ff)));
+			} else {
+				out.push_back(static_cast<wchar_t>(cp));
+			}
+		}
+
+		inline void put(std::string & out, char32_t cp) {
+			if (cp < 0x80) {
+				out.push_back(static_cast<char>(cp));
+			} else if (cp < 0x800) {
+				out.push_back(static_cast<char>(0xc0 | (cp >> 6)));
+				out.push_back(static_cast<char>(0x80 | (cp & 0x3f)));
+			} else if (cp < 0x10000) {
+				out.push_back(static_cast<char>(0xe0 | (cp >> 12)));
+				out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3f)));
+				out.push_back(static_cast<char>(0x80 | (cp & 0x3f)));
+			} else {
+				out.push_back(static_cast<char>(0xf0 | (cp >> 18)));
+				out.push_back(static_cast<char>(0x80 | ((cp >> 12) & 0x3f)));
+				out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3f)));
+				out.push_back(static_cast<char>(0x80 | (cp & 0x3f)));
+			}
+		}
+	}
+
+	LD_DECL void s2wstr(std::string_view src, std::wstring & out) {
+		LD_STAT(CONVERSIONS, 1);
+
+		const auto * bytes = reinterpret_cast<const unsigned char *>(
+			src.data()
+		);
+
+		size_t len = src.size();
+		size_t i   = 0;
+
+		while (i < len) {
+			// plain ASCII doesn't need decoding
+			while (i < len && bytes[i] < 0x80) {
+				out.push_back(static_cast<wchar_t>(bytes[i++]));
+			}
+
+			if (i == len) {
+				break;
+			}
+
+			unsigned char lead = bytes[i];
+			size_t        more;
+			char32_t      cp;
+			char32_t      min;
+
+			if ((lead & 0xe0) == 0xc0) {
+				more = 1;
+				cp   = lead & 0x1f;
+				min  = 0x80;
+			} else if ((lead & 0xf0) == 0xe0) {
+				more = 2;
+				cp   = lead & 0x0f;
+				min  = 0x800;
+			} else if ((lead & 0xf8) == 0xf0) {
+				more = 3;
+				cp   = lead & 0x07;
+				min  = 0x10000;
+			} else {
+				throw std::range_error("s2wstr: invalid UTF-8");
+			}
+
+			if (len - i <= more) {
+				throw std::range_error("s2wstr: truncated UTF-8");
+			}
+
+			for (size_t j = 1; j <= more; j++) {
+				if ((bytes[i + j] & 0xc0) != 0x80) {
+					throw std::range_error("s2wstr: invalid UTF-8");
+				}
+
+				cp = (cp << 6) | (bytes[i + j] & 0x3f);
+			}
+
+			if (cp < min || cp > 0x10ffff || (cp >= 0xd800 && cp < 0xe000)) {
+				throw std::range_error("s2wstr: invalid UTF-8");
+			}
+
+			_wstr::put(out, cp);
+			i += more + 1;
+		}
+	}
+
+	LD_DECL std::wstring s2wstr(const std::string & src) {
+		std::wstring built;
+
+		built.reserve(src.size());
+		s2wstr(src, built);
+
+		return built;
+	}
+
+	LD_DECL void w2str(std::wstring_view src, std::string & out) {
+		LD_STAT(CONVERSIONS, 1);
+
+		for (size_t i = 0; i < src.size(); i++) {
+			auto cp = static_cast<char32_t>(src[i]);
+
+			if (cp >= 0xd800 && cp < 0xdc00 && i + 1 < src.size() &&
+			    src[i + 1] >= 0xdc00 && src[i + 1] < 0xe000) {
+				cp = 0x10000 + ((cp - 0xd800) << 10) +
+				     (static_cast<char32_t>(src[++i]) - 0xdc00);
+			} else if ((cp >= 0xd800 && cp < 0xe000) || cp > 0x10ffff) {
+				throw std::range_error("w2str: invalid code point");
+			}
+
+			_wstr::put(out, cp);
+		}
+	}
+
+	LD_DECL std::string w2str(const std::wstring & src) {
+		std::string built;
+
+		built.reserve(src.size());
+		w2str(src, built);
+
+		return built;
+	}
+
+	LD_DECL std::wstring c2wstr(const char * src) {
 		return s2wstr(std::string(src));
 	}
 }
+#endif
 
 #endif //__LD_WSTR_HPP
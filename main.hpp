@@ -1,17 +1,29 @@
 #ifndef __LD_BOILERPLATE_HPP
 #define __LD_BOILERPLATE_HPP
 
-#include "ld_termcolor.hpp"
-#include "ld_linenoise.hpp"
+#include "ld_trace.hpp"
 #include "ld_wstr.hpp"
 #include "ld_output.hpp"
+#include "ld_vt.hpp"
+#include "ld_mmap.hpp"
+#include "ld_arena.hpp"
+#include "ld_complete.hpp"
 #include "ld_input.hpp"
 #include "ld_sutil.hpp"
 #include "ld_prng.hpp"
+#include "ld_sample.hpp"
 #include "ld_num.hpp"
 #include "ld_container.hpp"
+#include "ld_csv.hpp"
 #include "ld_ansi.hpp"
 #include "ld_tui.hpp"
+#include "ld_event.hpp"
+#include "ld_frame.hpp"
+#include "ld_layout.hpp"
+#include "ld_menu.hpp"
+#include "ld_scrollback.hpp"
+#include "ld_pane.hpp"
+#include "ld_progress.hpp"
 #include "ld_sgr.hpp"
 
 #endif // __LD_BOILERPLATE_HPP
\ No newline at end of file
@@ -0,0 +1,12 @@
+/*
+ * The out-of-line definitions of everything marked LD_DECL, for when the
+ * library is built with LD_SEPARATE_COMPILATION (see ld_config.hpp).
+ */
+
+#ifndef LD_SEPARATE_COMPILATION
+	#error "build this with LD_SEPARATE_COMPILATION defined"
+#endif
+
+#define LD_BUILDING_LIBRARY
+
+#include "../main.hpp"
@@ -0,0 +1,235 @@
+/*
+ * A C++20 module interface for the library, built by the CMake
+ * `ld_boilerplate_module` target when LD_BUILD_MODULE is on:
+ *
+ *     import ld_boilerplate;
+ *
+ * It exports everything public in namespace LD. Macros, like
+ * LD_TRACE_SCOPE or the termcolor styles, can't be exported from a module,
+ * so code that uses them still has to include the headers.
+ */
+
+module;
+
+#include "../main.hpp"
+
+export module ld_boilerplate;
+
+export namespace LD {
+	// ld_wstr.hpp
+	using LD::s2wstr;
+	using LD::w2str;
+	using LD::c2wstr;
+	using LD::wtostring;
+	using LD::append_wnum;
+
+	// ld_output.hpp
+	using LD::OutputSink;
+	using LD::output_sink;
+	using LD::set_output_sink;
+	using LD::o;
+	using LD::fl;
+	using LD::ofl;
+	using LD::nl;
+	using LD::log;
+	using LD::lognl;
+	using LD::err;
+	using LD::errnl;
+
+	// ld_vt.hpp, ld_mmap.hpp, ld_arena.hpp
+	using LD::VirtualTerminal;
+	using LD::VtCapture;
+	using LD::MappedFile;
+	using LD::CountingResource;
+	using LD::FrameArena;
+
+	// ld_complete.hpp, ld_input.hpp
+	using LD::CompletionIndex;
+	using LD::History;
+	using LD::BulkInput;
+	using LD::Completer;
+	using LD::InputHooks;
+	using LD::input_hooks;
+	using LD::set_completer;
+	using LD::set_history;
+	using LD::get_input;
+	using LD::is_chars_num;
+	using LD::get_bulk_num;
+	using LD::get_num_input;
+	using LD::get_num_inputs;
+	using LD::get_yn;
+	using LD::option_menu;
+
+	// ld_sutil.hpp
+	using LD::consume_word;
+	using LD::remove_leading_ws;
+	using LD::remove_trailing_ws;
+	using LD::remove_surrounding_ws;
+	using LD::pad;
+	using LD::split_str;
+	using LD::join_str;
+	using LD::pad_multiline;
+	using LD::get_dimensions;
+	using LD::tabulate;
+	using LD::render_tabulated;
+
+	// ld_prng.hpp, ld_sample.hpp
+	using LD::get_secure_RNG;
+	using LD::get_rn;
+	using LD::splitmix64;
+	using LD::Xoshiro256;
+	using LD::RNGStreams;
+	using LD::next_u64;
+	using LD::next_open_unit;
+	using LD::get_bounded;
+	using LD::shuffle;
+	using LD::reservoir_sample;
+	using LD::AliasTable;
+
+	// ld_num.hpp
+	using LD::ipow;
+	using LD::rpow;
+	using LD::rmod;
+	using LD::abs;
+	using LD::from_string;
+	using LD::DecimalNotation;
+	using LD::FIXED;
+	using LD::SCIENTIFIC;
+	using LD::REPEATING;
+	using LD::append_decimal;
+	using LD::to_decimal;
+
+	// ld_container.hpp, ld_csv.hpp
+	using LD::format_container;
+	using LD::wstr_container;
+	using LD::CsvTable;
+
+	// ld_ansi.hpp, ld_frame.hpp
+	using LD::ANSI;
+	using LD::FrameScheduler;
+
+	// ld_menu.hpp, ld_scrollback.hpp, ld_pane.hpp, ld_progress.hpp
+	using LD::OptionIndex;
+	using LD::search_menu;
+	using LD::Scrollback;
+	using LD::view_scrollback;
+	using LD::Pane;
+	using LD::PaneManager;
+	using LD::ProgressBar;
+	using LD::Progress;
+
+	namespace Trace {
+		using LD::Trace::Counter;
+		using LD::Trace::CHARS_WRITTEN;
+		using LD::Trace::WRITES;
+		using LD::Trace::FLUSHES;
+		using LD::Trace::ESCAPES;
+		using LD::Trace::KEYS_DECODED;
+		using LD::Trace::INPUT_READS;
+		using LD::Trace::CONVERSIONS;
+		using LD::Trace::CELLS_RENDERED;
+		using LD::Trace::COUNTER_COUNT;
+		using LD::Trace::counter_name;
+		using LD::Trace::counters;
+		using LD::Trace::add;
+		using LD::Trace::get;
+	}
+
+	namespace TUI {
+		using LD::TUI::Keys;
+		using LD::TUI::RawMode;
+		using LD::TUI::InputReader;
+		using LD::TUI::terminal_size;
+		using LD::TUI::Mouse;
+		using LD::TUI::KeyDecoder;
+		using LD::TUI::poll_key;
+		using LD::TUI::getch;
+		using LD::TUI::Event;
+		using LD::TUI::Task;
+		using LD::TUI::EventLoop;
+	}
+
+	namespace Layout {
+		using LD::Layout::Node;
+		using LD::Layout::Label;
+		using LD::Layout::Stack;
+		using LD::Layout::Box;
+	}
+
+	namespace SGR {
+		using LD::SGR::RESET;
+		using LD::SGR::BOLD;
+		using LD::SGR::DIM;
+		using LD::SGR::ITALIC;
+		using LD::SGR::UNDERLINE;
+		using LD::SGR::SLOW_BLINK;
+		using LD::SGR::RAPID_BLINK;
+		using LD::SGR::REVERSE;
+		using LD::SGR::CONCEAL;
+		using LD::SGR::STRIKETHROUGH;
+		using LD::SGR::FRAKTUR;
+		using LD::SGR::BOLD_OFF;
+		using LD::SGR::REGULAR;
+		using LD::SGR::NORMAL;
+		using LD::SGR::NO_UNDERLINE;
+		using LD::SGR::NO_BLINK;
+		using LD::SGR::NO_REVERSE;
+		using LD::SGR::NO_CONCEAL;
+		using LD::SGR::NO_STRIKETHROUGH;
+		using LD::SGR::BLACK;
+		using LD::SGR::RED;
+		using LD::SGR::GREEN;
+		using LD::SGR::YELLOW;
+		using LD::SGR::BLUE;
+		using LD::SGR::MAGENTA;
+		using LD::SGR::CYAN;
+		using LD::SGR::WHITE;
+		using LD::SGR::SET_FG;
+		using LD::SGR::DEFAULT_FG;
+		using LD::SGR::BG_BLACK;
+		using LD::SGR::BG_RED;
+		using LD::SGR::BG_GREEN;
+		using LD::SGR::BG_YELLOW;
+		using LD::SGR::BG_BLUE;
+		using LD::SGR::BG_MAGENTA;
+		using LD::SGR::BG_CYAN;
+		using LD::SGR::BG_WHITE;
+		using LD::SGR::SET_BG;
+		using LD::SGR::DEFAULT_BG;
+		using LD::SGR::FRAMED;
+		using LD::SGR::ENCIRCLED;
+		using LD::SGR::OVERLINED;
+		using LD::SGR::NO_BORDER;
+		using LD::SGR::NO_OVERLINE;
+		using LD::SGR::BRIGHT_BLACK;
+		using LD::SGR::BRIGHT_RED;
+		using LD::SGR::BRIGHT_GREEN;
+		using LD::SGR::BRIGHT_YELLOW;
+		using LD::SGR::BRIGHT_BLUE;
+		using LD::SGR::BRIGHT_MAGENTA;
+		using LD::SGR::BRIGHT_CYAN;
+		using LD::SGR::BRIGHT_WHITE;
+		using LD::SGR::BG_BRIGHT_BLACK;
+		using LD::SGR::BG_BRIGHT_RED;
+		using LD::SGR::BG_BRIGHT_GREEN;
+		using LD::SGR::BG_BRIGHT_YELLOW;
+		using LD::SGR::BG_BRIGHT_BLUE;
+		using LD::SGR::BG_BRIGHT_MAGENTA;
+		using LD::SGR::BG_BRIGHT_CYAN;
+		using LD::SGR::BG_BRIGHT_WHITE;
+		using LD::SGR::CSI;
+		using LD::SGR::reset;
+		using LD::SGR::SGR;
+		using LD::SGR::ColorMode;
+		using LD::SGR::COLORS_16;
+		using LD::SGR::COLORS_256;
+		using LD::SGR::TRUECOLOR;
+		using LD::SGR::RGB;
+		using LD::SGR::detect_color_mode;
+		using LD::SGR::color_mode;
+		using LD::SGR::nearest_256;
+		using LD::SGR::nearest_16;
+		using LD::SGR::fg;
+		using LD::SGR::bg;
+	}
+}
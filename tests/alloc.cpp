@@ -0,0 +1,148 @@
+/*
+ * Renders 100 rows per frame through LD::FrameScheduler, building every row
+ * in the frame's arena, and fails if anything touches the global heap after
+ * the first frame. operator new is replaced to count allocations.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string_view>
+
+#include "../ld_ansi.hpp"
+#include "../ld_frame.hpp"
+#include "../ld_output.hpp"
+#include "../ld_sgr.hpp"
+#include "../ld_sutil.hpp"
+#include "../ld_wstr.hpp"
+
+namespace {
+	size_t allocations = 0;
+
+	void * allocate(size_t size, size_t align = 0) {
+		allocations++;
+
+		void * ptr = align > alignof(std::max_align_t)
+			? std::aligned_alloc(align, (size + align - 1) / align * align)
+			: std::malloc(size > 0 ? size : 1);
+
+		if (ptr == nullptr) {
+			throw std::bad_alloc();
+		}
+
+		return ptr;
+	}
+}
+
+void * operator new(size_t size) {
+	return allocate(size);
+}
+
+void * operator new(size_t size, std::align_val_t align) {
+	return allocate(size, static_cast<size_t>(align));
+}
+
+void operator delete(void * ptr) noexcept {
+	std::free(ptr);
+}
+
+void operator delete(void * ptr, size_t) noexcept {
+	std::free(ptr);
+}
+
+void operator delete(void * ptr, std::align_val_t) noexcept {
+	std::free(ptr);
+}
+
+void operator delete(void * ptr, size_t, std::align_val_t) noexcept {
+	std::free(ptr);
+}
+
+namespace {
+	constexpr size_t ROWS   = 100;
+	constexpr size_t FRAMES = 50;
+
+	// what CTest takes to mean the test didn't run
+	constexpr int SKIPPED = 77;
+
+	void render(LD::FrameScheduler & frames, size_t selected) {
+		using LD::ANSI;
+
+		std::pmr::memory_resource & mem = frames.arena().resource();
+
+		frames.write(ANSI::c_home(mem));
+
+		for (size_t row = 0; row < ROWS; row++) {
+			std::pmr::wstring label(& mem);
+
+			label.append(L"item ");
+			LD::append_wnum(label, row);
+
+			if (row == selected) {
+				frames.write(LD::SGR::SGR(mem, {LD::SGR::REVERSE}));
+			}
+
+			frames.write(LD::pad(mem, label, 40));
+
+			if (row == selected) {
+				frames.write(LD::SGR::reset(mem));
+			}
+
+			frames.write(ANSI::erase_line(mem, ANSI::ELINEFROMC));
+			frames.write(ANSI::c_down(mem, 0));
+		}
+
+		frames.idle();
+	}
+}
+
+int main() {
+	// @formatter:off
+#ifdef LD_USE_TRACE
+	// spans are recorded into a buffer that grows as it fills up
+	std::printf("skipped: LD_USE_TRACE allocates for every span\n");
+
+	return SKIPPED;
+#endif
+	// @formatter:on
+
+	size_t bytes = 0;
+
+	LD::set_output_sink([&bytes](std::wstring_view text) {
+		bytes += text.size();
+	});
+
+	size_t before;
+
+	{
+		LD::FrameScheduler frames(60, false);
+
+		render(frames, 0);
+		before = allocations;
+
+		for (size_t frame = 1; frame < FRAMES; frame++) {
+			render(frames, frame % ROWS);
+		}
+
+		if (frames.frame_count() != FRAMES || bytes == 0) {
+			std::fprintf(stderr, "only %zu of %zu frames were sent\n",
+			             frames.frame_count(), FRAMES);
+
+			return 1;
+		}
+	}
+
+	LD::set_output_sink(nullptr);
+
+	if (allocations != before) {
+		std::fprintf(stderr, "%zu allocations after the first frame\n",
+		             allocations - before);
+
+		return 1;
+	}
+
+	std::printf("%zu frames, %zu characters, no allocations after the first\n",
+	            FRAMES, bytes);
+
+	return 0;
+}
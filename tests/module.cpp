@@ -0,0 +1,47 @@
+/*
+ * Imports the ld_boilerplate module instead of including the headers, and
+ * uses a few things from different parts of it, so a name that isn't
+ * exported, or one that is but doesn't work through the module, fails
+ * the build or the test. Only built when LD_BUILD_MODULE is on.
+ */
+
+#include <cstdio>
+#include <string>
+
+import ld_boilerplate;
+
+namespace {
+	size_t failures = 0;
+
+	void check(bool ok, const char * what) {
+		if (!ok) {
+			std::fprintf(stderr, "FAIL: %s\n", what);
+			failures++;
+		}
+	}
+}
+
+int main() {
+	LD::VirtualTerminal vt(20, 5);
+
+	{
+		LD::VtCapture capture(vt);
+
+		LD::o(LD::render_tabulated(LD::tabulate({{L"n", L"42"}})));
+		LD::o(LD::ANSI::c_up(1));
+	}
+
+	check(vt.screen() == L"┌───┬────┐\n"
+	                     L"│ n │ 42 │\n"
+	                     L"└───┴────┘", "table through the module");
+	check(vt.end_frame().sequences == 1, "ANSI through the module");
+
+	check(LD::wtostring(42) == L"42", "wtostring");
+	check(LD::SGR::fg({255, 0, 0}, LD::SGR::COLORS_16) == L"\033[91m",
+	      "SGR::fg");
+
+	LD::Xoshiro256 rng(42);
+	check(LD::get_bounded(rng, 10) < 10, "get_bounded");
+
+	return failures == 0 ? 0 : 1;
+}
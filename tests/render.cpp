@@ -0,0 +1,124 @@
+/*
+ * Renders through a LD::VirtualTerminal and checks what ends up on the
+ * screen, and that it didn't take more bytes or escape sequences than it
+ * should: a table from render_tabulated, an option_menu answering input
+ * from a pipe, and the terminal modes switched through RawMode.
+ */
+
+#include <unistd.h>
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "../ld_input.hpp"
+#include "../ld_output.hpp"
+#include "../ld_sutil.hpp"
+#include "../ld_tui.hpp"
+#include "../ld_vt.hpp"
+
+namespace {
+	size_t failures = 0;
+
+	void check(bool ok, const char * what) {
+		if (!ok) {
+			std::fprintf(stderr, "FAIL: %s\n", what);
+			failures++;
+		}
+	}
+
+	void table() {
+		LD::VirtualTerminal vt(40, 10);
+		LD::VtCapture       capture(vt);
+
+		LD::o(LD::render_tabulated(LD::tabulate({
+			{L"name", L"size"},
+			{L"a.txt", L"12"},
+			{L"b.txt", L"3456"}
+		})));
+
+		auto stats = vt.end_frame();
+
+		check(vt.screen() == L"┌───────┬──────┐\n"
+		                     L"│ name  │ size │\n"
+		                     L"├───────┼──────┤\n"
+		                     L"│ a.txt │ 12   │\n"
+		                     L"├───────┼──────┤\n"
+		                     L"│ b.txt │ 3456 │\n"
+		                     L"└───────┴──────┘", "table screen");
+
+		// 7 lines of 16 box-drawing or plain cells, and the newlines
+		check(stats.printed == 7 * 16, "table prints every cell once");
+		check(stats.bytes <= 7 * 16 * 3 + 6, "table byte budget");
+		check(stats.sequences == 0, "table has no escape sequences");
+	}
+
+	void menu() {
+		int fds[2];
+
+		if (pipe(fds) != 0) {
+			check(false, "pipe for the menu's input");
+
+			return;
+		}
+
+		// an out of range choice first, so the menu has to be shown twice
+		const char input[] = "9\n2\n";
+
+		check(write(fds[1], input, sizeof(input) - 1) == sizeof(input) - 1,
+		      "write the menu's input");
+		close(fds[1]);
+		dup2(fds[0], 0);
+		close(fds[0]);
+
+		LD::VirtualTerminal vt(80, 24);
+		LD::VtCapture       capture(vt);
+		math::Unsigned      selected;
+
+		LD::option_menu({L"one", L"two", L"three", L"four"}, selected);
+
+		auto        stats  = vt.end_frame();
+		std::wstring screen = vt.screen();
+
+		check(selected == 2, "menu picks the second answer");
+		check(screen.find(L"0) one") != std::wstring::npos, "menu lists options");
+		check(screen.find(L"3) four") != std::wstring::npos, "menu lists every option");
+		check(screen.find(L"You must enter a valid choice!") != std::wstring::npos,
+		      "menu rejects an out of range choice");
+		check(stats.bytes <= 320, "menu byte budget");
+		check(stats.cursor_moves == 0, "menu doesn't move the cursor");
+	}
+
+	void modes() {
+		LD::VirtualTerminal vt(20, 5);
+		LD::VtCapture       capture(vt);
+
+		{
+			LD::TUI::RawMode raw;
+
+			LD::TUI::RawMode::alt_screen(true);
+			LD::TUI::RawMode::hide_cursor(true);
+
+			check(vt.alt_screen(), "alt screen goes through the sink");
+			check(!vt.cursor_visible(), "hidden cursor goes through the sink");
+		}
+
+		check(!vt.alt_screen(), "raw mode leaves the alt screen");
+		check(vt.cursor_visible(), "raw mode shows the cursor again");
+		check(vt.end_frame().sequences == 4, "one sequence per mode switch");
+	}
+}
+
+int main() {
+	table();
+	menu();
+	modes();
+
+	if (failures > 0) {
+		return 1;
+	}
+
+	std::printf("ok\n");
+
+	return 0;
+}